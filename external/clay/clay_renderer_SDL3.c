@@ -14,137 +14,262 @@ typedef struct {
  * no AA or low resolution might make it appear as jagged curves) */
 static int NUM_CIRCLE_SEGMENTS = 16;
 
-//all rendering is performed by a single SDL call, avoiding multiple RenderRect + plumbing choice for circles.
-static void SDL_Clay_RenderFillRoundedRect(Clay_SDL3RendererData *rendererData, const SDL_FRect rect, const float cornerRadius, const Clay_Color _color) {
-    const SDL_FColor color = { _color.r/255, _color.g/255, _color.b/255, _color.a/255 };
-
-    int indexCount = 0, vertexCount = 0;
-
-    const float minRadius = SDL_min(rect.w, rect.h) / 2.0f;
-    const float clampedRadius = SDL_min(cornerRadius, minRadius);
-
-    const int numCircleSegments = SDL_max(NUM_CIRCLE_SEGMENTS, (int) clampedRadius * 0.5f);
-
-    int totalVertices = 4 + (4 * (numCircleSegments * 2)) + 2*4;
-    int totalIndices = 6 + (4 * (numCircleSegments * 3)) + 6*4;
-
-    SDL_Vertex vertices[totalVertices];
-    int indices[totalIndices];
-
-    //define center rectangle
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + clampedRadius, rect.y + clampedRadius}, color, {0, 0} }; //0 center TL
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w - clampedRadius, rect.y + clampedRadius}, color, {1, 0} }; //1 center TR
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w - clampedRadius, rect.y + rect.h - clampedRadius}, color, {1, 1} }; //2 center BR
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + clampedRadius, rect.y + rect.h - clampedRadius}, color, {0, 1} }; //3 center BL
-
-    indices[indexCount++] = 0;
-    indices[indexCount++] = 1;
-    indices[indexCount++] = 3;
-    indices[indexCount++] = 1;
-    indices[indexCount++] = 2;
-    indices[indexCount++] = 3;
-
-    //define rounded corners as triangle fans
-    const float step = (SDL_PI_F/2) / numCircleSegments;
-    for (int i = 0; i < numCircleSegments; i++) {
-        const float angle1 = (float)i * step;
-        const float angle2 = ((float)i + 1.0f) * step;
-
-        for (int j = 0; j < 4; j++) {  // Iterate over four corners
-            float cx, cy, signX, signY;
-
-            switch (j) {
-                case 0: cx = rect.x + clampedRadius; cy = rect.y + clampedRadius; signX = -1; signY = -1; break; // Top-left
-                case 1: cx = rect.x + rect.w - clampedRadius; cy = rect.y + clampedRadius; signX = 1; signY = -1; break; // Top-right
-                case 2: cx = rect.x + rect.w - clampedRadius; cy = rect.y + rect.h - clampedRadius; signX = 1; signY = 1; break; // Bottom-right
-                case 3: cx = rect.x + clampedRadius; cy = rect.y + rect.h - clampedRadius; signX = -1; signY = 1; break; // Bottom-left
-                default: return;
-            }
+#define MAX_CIRCLE_SEGMENTS 128
+
+/* Rectangles, rounded rectangles and borders are appended to one vertex/index stream
+ * and submitted with a single SDL_RenderGeometry per clip rect. Text is deferred
+ * alongside the geometry and only forces a flush when later geometry overlaps it, so
+ * paint order is preserved without splitting the batch at every label. */
+typedef struct {
+    SDL_Vertex *vertices;
+    int *indices;
+    int vertexCount, vertexCapacity;
+    int indexCount, indexCapacity;
+    Clay_RenderCommand **texts;
+    int textCount, textCapacity;
+    SDL_Rect clip;
+    bool clipEnabled;
+    int drawCalls;              // submitted during the last SDL_Clay_RenderClayCommands
+} SDL_Clay_Batch;
+
+static SDL_Clay_Batch clayBatch;
+
+/* Unit quarter circles from 0 to 90 degrees, one table per segment count. */
+static SDL_FPoint *clayCornerTables[MAX_CIRCLE_SEGMENTS + 1];
+
+static const SDL_FPoint *SDL_Clay_CornerTable(int segments) {
+    SDL_FPoint **tables = clayCornerTables;
+
+    segments = SDL_clamp(segments, 1, MAX_CIRCLE_SEGMENTS);
+    if (!tables[segments]) {
+        SDL_FPoint *table = SDL_malloc(sizeof(SDL_FPoint) * (segments + 1));
+        if (!table) return NULL;
+        const float step = (SDL_PI_F / 2) / segments;
+        for (int i = 0; i <= segments; i++) {
+            table[i] = (SDL_FPoint){ SDL_cosf(i * step), SDL_sinf(i * step) };
+        }
+        tables[segments] = table;
+    }
+    return tables[segments];
+}
+
+static bool SDL_Clay_Reserve(int vertices, int indices) {
+    SDL_Clay_Batch *b = &clayBatch;
+    if (b->vertexCount + vertices > b->vertexCapacity) {
+        int capacity = SDL_max(b->vertexCapacity * 2, b->vertexCount + vertices + 1024);
+        SDL_Vertex *grown = SDL_realloc(b->vertices, sizeof(SDL_Vertex) * capacity);
+        if (!grown) return false;
+        b->vertices = grown;
+        b->vertexCapacity = capacity;
+    }
+    if (b->indexCount + indices > b->indexCapacity) {
+        int capacity = SDL_max(b->indexCapacity * 2, b->indexCount + indices + 2048);
+        int *grown = SDL_realloc(b->indices, sizeof(int) * capacity);
+        if (!grown) return false;
+        b->indices = grown;
+        b->indexCapacity = capacity;
+    }
+    return true;
+}
+
+static inline SDL_FColor SDL_Clay_FColor(const Clay_Color color) {
+    return (SDL_FColor){ color.r / 255, color.g / 255, color.b / 255, color.a / 255 };
+}
+
+static inline int SDL_Clay_SegmentsFor(float radius) {
+    return radius > 0 ? SDL_max(NUM_CIRCLE_SEGMENTS, (int)(radius * 0.5f)) : 1;
+}
 
-            vertices[vertexCount++] = (SDL_Vertex){ {cx + SDL_cosf(angle1) * clampedRadius * signX, cy + SDL_sinf(angle1) * clampedRadius * signY}, color, {0, 0} };
-            vertices[vertexCount++] = (SDL_Vertex){ {cx + SDL_cosf(angle2) * clampedRadius * signX, cy + SDL_sinf(angle2) * clampedRadius * signY}, color, {0, 0} };
+/* Point on the outline of corner `corner` (0 TL, 1 TR, 2 BR, 3 BL) at table entry u,
+ * walking clockwise. Rotating the 0..90 table by whole quadrants avoids any trig. */
+static inline SDL_FPoint SDL_Clay_CornerPoint(int corner, SDL_FPoint u, float cx, float cy, float rx, float ry) {
+    switch (corner) {
+        case 0:  return (SDL_FPoint){ cx - u.x * rx, cy - u.y * ry }; // 180..270
+        case 1:  return (SDL_FPoint){ cx + u.y * rx, cy - u.x * ry }; // 270..360
+        case 2:  return (SDL_FPoint){ cx + u.x * rx, cy + u.y * ry }; // 0..90
+        default: return (SDL_FPoint){ cx - u.y * rx, cy + u.x * ry }; // 90..180
+    }
+}
+
+static void SDL_Clay_BatchRect(const SDL_FRect rect, const Clay_Color color) {
+    if (!SDL_Clay_Reserve(4, 6)) return;
+    SDL_Clay_Batch *b = &clayBatch;
+    const SDL_FColor c = SDL_Clay_FColor(color);
+    const int base = b->vertexCount;
+
+    b->vertices[b->vertexCount++] = (SDL_Vertex){ { rect.x, rect.y }, c, { 0, 0 } };
+    b->vertices[b->vertexCount++] = (SDL_Vertex){ { rect.x + rect.w, rect.y }, c, { 0, 0 } };
+    b->vertices[b->vertexCount++] = (SDL_Vertex){ { rect.x + rect.w, rect.y + rect.h }, c, { 0, 0 } };
+    b->vertices[b->vertexCount++] = (SDL_Vertex){ { rect.x, rect.y + rect.h }, c, { 0, 0 } };
 
-            indices[indexCount++] = j;  // Connect to corresponding central rectangle vertex
-            indices[indexCount++] = vertexCount - 2;
-            indices[indexCount++] = vertexCount - 1;
+    static const int quad[6] = { 0, 1, 3, 1, 2, 3 };
+    for (int i = 0; i < 6; i++) b->indices[b->indexCount++] = base + quad[i];
+}
+
+//rounded rectangles are convex, so a single fan from the center covers them.
+static void SDL_Clay_BatchRoundedRect(const SDL_FRect rect, const Clay_CornerRadius radii, const Clay_Color color) {
+    const float maxRadius = SDL_min(rect.w, rect.h) / 2.0f;
+    const float r[4] = {
+        SDL_min(radii.topLeft, maxRadius), SDL_min(radii.topRight, maxRadius),
+        SDL_min(radii.bottomRight, maxRadius), SDL_min(radii.bottomLeft, maxRadius)
+    };
+    const float cx[4] = { rect.x + r[0], rect.x + rect.w - r[1], rect.x + rect.w - r[2], rect.x + r[3] };
+    const float cy[4] = { rect.y + r[0], rect.y + r[1], rect.y + rect.h - r[2], rect.y + rect.h - r[3] };
+
+    int outline = 0;
+    int segments[4];
+    for (int j = 0; j < 4; j++) {
+        segments[j] = SDL_min(SDL_Clay_SegmentsFor(r[j]), MAX_CIRCLE_SEGMENTS);
+        outline += segments[j] + 1;
+    }
+    if (!SDL_Clay_Reserve(outline + 1, outline * 3)) return;
+
+    SDL_Clay_Batch *b = &clayBatch;
+    const SDL_FColor c = SDL_Clay_FColor(color);
+    const int hub = b->vertexCount;
+    b->vertices[b->vertexCount++] = (SDL_Vertex){ { rect.x + rect.w / 2, rect.y + rect.h / 2 }, c, { 0, 0 } };
+
+    for (int j = 0; j < 4; j++) {
+        const SDL_FPoint *table = SDL_Clay_CornerTable(segments[j]);
+        if (!table) return;
+        for (int i = 0; i <= segments[j]; i++) {
+            b->vertices[b->vertexCount++] = (SDL_Vertex){ SDL_Clay_CornerPoint(j, table[i], cx[j], cy[j], r[j], r[j]), c, { 0, 0 } };
         }
     }
 
-    //Define edge rectangles
-    // Top edge
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + clampedRadius, rect.y}, color, {0, 0} }; //TL
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w - clampedRadius, rect.y}, color, {1, 0} }; //TR
-
-    indices[indexCount++] = 0;
-    indices[indexCount++] = vertexCount - 2; //TL
-    indices[indexCount++] = vertexCount - 1; //TR
-    indices[indexCount++] = 1;
-    indices[indexCount++] = 0;
-    indices[indexCount++] = vertexCount - 1; //TR
-    // Right edge
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w, rect.y + clampedRadius}, color, {1, 0} }; //RT
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w, rect.y + rect.h - clampedRadius}, color, {1, 1} }; //RB
-
-    indices[indexCount++] = 1;
-    indices[indexCount++] = vertexCount - 2; //RT
-    indices[indexCount++] = vertexCount - 1; //RB
-    indices[indexCount++] = 2;
-    indices[indexCount++] = 1;
-    indices[indexCount++] = vertexCount - 1; //RB
-    // Bottom edge
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + rect.w - clampedRadius, rect.y + rect.h}, color, {1, 1} }; //BR
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x + clampedRadius, rect.y + rect.h}, color, {0, 1} }; //BL
-
-    indices[indexCount++] = 2;
-    indices[indexCount++] = vertexCount - 2; //BR
-    indices[indexCount++] = vertexCount - 1; //BL
-    indices[indexCount++] = 3;
-    indices[indexCount++] = 2;
-    indices[indexCount++] = vertexCount - 1; //BL
-    // Left edge
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x, rect.y + rect.h - clampedRadius}, color, {0, 1} }; //LB
-    vertices[vertexCount++] = (SDL_Vertex){ {rect.x, rect.y + clampedRadius}, color, {0, 0} }; //LT
-
-    indices[indexCount++] = 3;
-    indices[indexCount++] = vertexCount - 2; //LB
-    indices[indexCount++] = vertexCount - 1; //LT
-    indices[indexCount++] = 0;
-    indices[indexCount++] = 3;
-    indices[indexCount++] = vertexCount - 1; //LT
-
-    // Render everything
-    SDL_RenderGeometry(rendererData->renderer, NULL, vertices, vertexCount, indices, indexCount);
+    for (int k = 0; k < outline; k++) {
+        b->indices[b->indexCount++] = hub;
+        b->indices[b->indexCount++] = hub + 1 + k;
+        b->indices[b->indexCount++] = hub + 1 + (k + 1) % outline;
+    }
 }
 
-static void SDL_Clay_RenderArc(Clay_SDL3RendererData *rendererData, const SDL_FPoint center, const float radius, const float startAngle, const float endAngle, const float thickness, const Clay_Color color) {
-    SDL_SetRenderDrawColor(rendererData->renderer, color.r, color.g, color.b, color.a);
+//borders are a strip between the outer outline and an inset inner outline; edges fall out of the corner joins.
+static void SDL_Clay_BatchBorder(const SDL_FRect rect, const Clay_BorderRenderData *config) {
+    const float maxRadius = SDL_min(rect.w, rect.h) / 2.0f;
+    const float r[4] = {
+        SDL_min(config->cornerRadius.topLeft, maxRadius), SDL_min(config->cornerRadius.topRight, maxRadius),
+        SDL_min(config->cornerRadius.bottomRight, maxRadius), SDL_min(config->cornerRadius.bottomLeft, maxRadius)
+    };
+    // width of the vertical and horizontal side touching each corner
+    const float wx[4] = { config->width.left, config->width.right, config->width.right, config->width.left };
+    const float wy[4] = { config->width.top, config->width.top, config->width.bottom, config->width.bottom };
+    const float sx[4] = { 1, -1, -1, 1 };
+    const float sy[4] = { 1, 1, -1, -1 };
+    const float ox[4] = { rect.x, rect.x + rect.w, rect.x + rect.w, rect.x };
+    const float oy[4] = { rect.y, rect.y, rect.y + rect.h, rect.y + rect.h };
+
+    int outline = 0;
+    int segments[4];
+    for (int j = 0; j < 4; j++) {
+        segments[j] = SDL_min(SDL_Clay_SegmentsFor(r[j]), MAX_CIRCLE_SEGMENTS);
+        outline += segments[j] + 1;
+    }
+    if (!SDL_Clay_Reserve(outline * 2, outline * 6)) return;
+
+    SDL_Clay_Batch *b = &clayBatch;
+    const SDL_FColor c = SDL_Clay_FColor(config->color);
+    const int base = b->vertexCount;
+
+    for (int j = 0; j < 4; j++) {
+        const SDL_FPoint *table = SDL_Clay_CornerTable(segments[j]);
+        if (!table) return;
+        // inner corner: square when the border is wider than the radius
+        const float ix = SDL_max(r[j], wx[j]), iy = SDL_max(r[j], wy[j]);
+        for (int i = 0; i <= segments[j]; i++) {
+            b->vertices[b->vertexCount++] = (SDL_Vertex){
+                SDL_Clay_CornerPoint(j, table[i], ox[j] + sx[j] * r[j], oy[j] + sy[j] * r[j], r[j], r[j]), c, { 0, 0 } };
+            b->vertices[b->vertexCount++] = (SDL_Vertex){
+                SDL_Clay_CornerPoint(j, table[i], ox[j] + sx[j] * ix, oy[j] + sy[j] * iy, ix - wx[j], iy - wy[j]), c, { 0, 0 } };
+        }
+    }
 
-    const float radStart = startAngle * (SDL_PI_F / 180.0f);
-    const float radEnd = endAngle * (SDL_PI_F / 180.0f);
+    for (int k = 0; k < outline; k++) {
+        const int o0 = base + 2 * k, i0 = o0 + 1;
+        const int o1 = base + 2 * ((k + 1) % outline), i1 = o1 + 1;
+        b->indices[b->indexCount++] = o0;
+        b->indices[b->indexCount++] = o1;
+        b->indices[b->indexCount++] = i0;
+        b->indices[b->indexCount++] = o1;
+        b->indices[b->indexCount++] = i1;
+        b->indices[b->indexCount++] = i0;
+    }
+}
 
-    const int numCircleSegments = SDL_max(NUM_CIRCLE_SEGMENTS, (int)(radius * 1.5f)); //increase circle segments for larger circles, 1.5 is arbitrary.
+static void SDL_Clay_DrawText(Clay_SDL3RendererData *rendererData, Clay_RenderCommand *rcmd) {
+    Clay_TextRenderData *config = &rcmd->renderData.text;
+    TTF_Font *font = rendererData->fonts[config->fontId];
+    TTF_SetFontSize(font, config->fontSize);
+    TTF_Text *text = TTF_CreateText(rendererData->textEngine, font, config->stringContents.chars, config->stringContents.length);
+    TTF_SetTextColor(text, config->textColor.r, config->textColor.g, config->textColor.b, config->textColor.a);
+    TTF_DrawRendererText(text, rcmd->boundingBox.x, rcmd->boundingBox.y);
+    TTF_DestroyText(text);
+    clayBatch.drawCalls++;
+}
 
-    const float angleStep = (radEnd - radStart) / (float)numCircleSegments;
-    const float thicknessStep = 0.4f; //arbitrary value to avoid overlapping lines. Changing THICKNESS_STEP or numCircleSegments might cause artifacts.
+/* Geometry first, then the deferred text that sits on top of it. */
+static void SDL_Clay_Flush(Clay_SDL3RendererData *rendererData) {
+    SDL_Clay_Batch *b = &clayBatch;
+    if (b->indexCount > 0) {
+        SDL_RenderGeometry(rendererData->renderer, NULL, b->vertices, b->vertexCount, b->indices, b->indexCount);
+        b->drawCalls++;
+    }
+    b->vertexCount = 0;
+    b->indexCount = 0;
 
-    for (float t = thicknessStep; t < thickness - thicknessStep; t += thicknessStep) {
-        SDL_FPoint points[numCircleSegments + 1];
-        const float clampedRadius = SDL_max(radius - t, 1.0f);
+    for (int i = 0; i < b->textCount; i++) {
+        SDL_Clay_DrawText(rendererData, b->texts[i]);
+    }
+    b->textCount = 0;
+}
 
-        for (int i = 0; i <= numCircleSegments; i++) {
-            const float angle = radStart + i * angleStep;
-            points[i] = (SDL_FPoint){
-                    SDL_roundf(center.x + SDL_cosf(angle) * clampedRadius),
-                    SDL_roundf(center.y + SDL_sinf(angle) * clampedRadius) };
+static bool SDL_Clay_OverlapsText(const SDL_FRect *rect) {
+    for (int i = 0; i < clayBatch.textCount; i++) {
+        const Clay_BoundingBox t = clayBatch.texts[i]->boundingBox;
+        const SDL_FRect tr = { t.x, t.y, t.width, t.height };
+        if (SDL_HasRectIntersectionFloat(rect, &tr)) return true;
+    }
+    return false;
+}
+
+static void SDL_Clay_DeferText(Clay_SDL3RendererData *rendererData, Clay_RenderCommand *rcmd) {
+    SDL_Clay_Batch *b = &clayBatch;
+    if (b->textCount == b->textCapacity) {
+        int capacity = SDL_max(b->textCapacity * 2, 64);
+        Clay_RenderCommand **grown = SDL_realloc(b->texts, sizeof(Clay_RenderCommand *) * capacity);
+        if (!grown) {
+            SDL_Clay_Flush(rendererData);
+            SDL_Clay_DrawText(rendererData, rcmd);
+            return;
         }
-        SDL_RenderLines(rendererData->renderer, points, numCircleSegments + 1);
+        b->texts = grown;
+        b->textCapacity = capacity;
     }
+    b->texts[b->textCount++] = rcmd;
+}
+
+static void SDL_Clay_SetClip(Clay_SDL3RendererData *rendererData, const SDL_Rect *clip) {
+    SDL_Clay_Batch *b = &clayBatch;
+    if (!clip && !b->clipEnabled) return;
+    if (clip && b->clipEnabled && SDL_RectsEqual(clip, &b->clip)) return;
+
+    SDL_Clay_Flush(rendererData);
+    b->clipEnabled = clip != NULL;
+    if (clip) b->clip = *clip;
+    SDL_SetRenderClipRect(rendererData->renderer, clip);
 }
 
 SDL_Rect currentClippingRectangle;
 
 static void SDL_Clay_RenderClayCommands(Clay_SDL3RendererData *rendererData, Clay_RenderCommandArray *rcommands)
 {
+    clayBatch.drawCalls = 0;
+    clayBatch.clipEnabled = SDL_RenderClipEnabled(rendererData->renderer);
+    if (clayBatch.clipEnabled) SDL_GetRenderClipRect(rendererData->renderer, &clayBatch.clip);
+
+    //untextured geometry picks up the draw blend mode, so it is set once per frame
+    SDL_SetRenderDrawBlendMode(rendererData->renderer, SDL_BLENDMODE_BLEND);
+
     for (size_t i = 0; i < rcommands->length; i++) {
         Clay_RenderCommand *rcmd = Clay_RenderCommandArray_Get(rcommands, i);
         const Clay_BoundingBox bounding_box = rcmd->boundingBox;
@@ -153,88 +278,25 @@ static void SDL_Clay_RenderClayCommands(Clay_SDL3RendererData *rendererData, Cla
         switch (rcmd->commandType) {
             case CLAY_RENDER_COMMAND_TYPE_RECTANGLE: {
                 Clay_RectangleRenderData *config = &rcmd->renderData.rectangle;
-                SDL_SetRenderDrawBlendMode(rendererData->renderer, SDL_BLENDMODE_BLEND);
-                SDL_SetRenderDrawColor(rendererData->renderer, config->backgroundColor.r, config->backgroundColor.g, config->backgroundColor.b, config->backgroundColor.a);
-                if (config->cornerRadius.topLeft > 0) {
-                    SDL_Clay_RenderFillRoundedRect(rendererData, rect, config->cornerRadius.topLeft, config->backgroundColor);
+                if (config->backgroundColor.a <= 0) break;
+                if (SDL_Clay_OverlapsText(&rect)) SDL_Clay_Flush(rendererData);
+                const Clay_CornerRadius radii = config->cornerRadius;
+                if (radii.topLeft > 0 || radii.topRight > 0 || radii.bottomLeft > 0 || radii.bottomRight > 0) {
+                    SDL_Clay_BatchRoundedRect(rect, radii, config->backgroundColor);
                 } else {
-                    SDL_RenderFillRect(rendererData->renderer, &rect);
+                    SDL_Clay_BatchRect(rect, config->backgroundColor);
                 }
             } break;
             case CLAY_RENDER_COMMAND_TYPE_TEXT: {
-                Clay_TextRenderData *config = &rcmd->renderData.text;
-                TTF_Font *font = rendererData->fonts[config->fontId];
-                TTF_SetFontSize(font, config->fontSize);
-                TTF_Text *text = TTF_CreateText(rendererData->textEngine, font, config->stringContents.chars, config->stringContents.length);
-                TTF_SetTextColor(text, config->textColor.r, config->textColor.g, config->textColor.b, config->textColor.a);
-                TTF_DrawRendererText(text, rect.x, rect.y);
-                TTF_DestroyText(text);
+                SDL_Clay_DeferText(rendererData, rcmd);
             } break;
             case CLAY_RENDER_COMMAND_TYPE_BORDER: {
                 Clay_BorderRenderData *config = &rcmd->renderData.border;
-
-                const float minRadius = SDL_min(rect.w, rect.h) / 2.0f;
-                const Clay_CornerRadius clampedRadii = {
-                    .topLeft = SDL_min(config->cornerRadius.topLeft, minRadius),
-                    .topRight = SDL_min(config->cornerRadius.topRight, minRadius),
-                    .bottomLeft = SDL_min(config->cornerRadius.bottomLeft, minRadius),
-                    .bottomRight = SDL_min(config->cornerRadius.bottomRight, minRadius)
-                };
-                //edges
-                SDL_SetRenderDrawColor(rendererData->renderer, config->color.r, config->color.g, config->color.b, config->color.a);
-                if (config->width.left > 0) {
-                    const float starting_y = rect.y + clampedRadii.topLeft;
-                    const float length = rect.h - clampedRadii.topLeft - clampedRadii.bottomLeft;
-                    SDL_FRect line = { rect.x - 1, starting_y, config->width.left, length };
-                    SDL_RenderFillRect(rendererData->renderer, &line);
-                }
-                if (config->width.right > 0) {
-                    const float starting_x = rect.x + rect.w - (float)config->width.right + 1;
-                    const float starting_y = rect.y + clampedRadii.topRight;
-                    const float length = rect.h - clampedRadii.topRight - clampedRadii.bottomRight;
-                    SDL_FRect line = { starting_x, starting_y, config->width.right, length };
-                    SDL_RenderFillRect(rendererData->renderer, &line);
-                }
-                if (config->width.top > 0) {
-                    const float starting_x = rect.x + clampedRadii.topLeft;
-                    const float length = rect.w - clampedRadii.topLeft - clampedRadii.topRight;
-                    SDL_FRect line = { starting_x, rect.y - 1, length, config->width.top };
-                    SDL_RenderFillRect(rendererData->renderer, &line);
-                }
-                if (config->width.bottom > 0) {
-                    const float starting_x = rect.x + clampedRadii.bottomLeft;
-                    const float starting_y = rect.y + rect.h - (float)config->width.bottom + 1;
-                    const float length = rect.w - clampedRadii.bottomLeft - clampedRadii.bottomRight;
-                    SDL_FRect line = { starting_x, starting_y, length, config->width.bottom };
-                    SDL_SetRenderDrawColor(rendererData->renderer, config->color.r, config->color.g, config->color.b, config->color.a);
-                    SDL_RenderFillRect(rendererData->renderer, &line);
-                }
-                //corners
-                if (config->cornerRadius.topLeft > 0) {
-                    const float centerX = rect.x + clampedRadii.topLeft -1;
-                    const float centerY = rect.y + clampedRadii.topLeft - 1;
-                    SDL_Clay_RenderArc(rendererData, (SDL_FPoint){centerX, centerY}, clampedRadii.topLeft,
-                        180.0f, 270.0f, config->width.top, config->color);
-                }
-                if (config->cornerRadius.topRight > 0) {
-                    const float centerX = rect.x + rect.w - clampedRadii.topRight;
-                    const float centerY = rect.y + clampedRadii.topRight - 1;
-                    SDL_Clay_RenderArc(rendererData, (SDL_FPoint){centerX, centerY}, clampedRadii.topRight,
-                        270.0f, 360.0f, config->width.top, config->color);
-                }
-                if (config->cornerRadius.bottomLeft > 0) {
-                    const float centerX = rect.x + clampedRadii.bottomLeft -1;
-                    const float centerY = rect.y + rect.h - clampedRadii.bottomLeft;
-                    SDL_Clay_RenderArc(rendererData, (SDL_FPoint){centerX, centerY}, clampedRadii.bottomLeft,
-                        90.0f, 180.0f, config->width.bottom, config->color);
-                }
-                if (config->cornerRadius.bottomRight > 0) {
-                    const float centerX = rect.x + rect.w - clampedRadii.bottomRight;
-                    const float centerY = rect.y + rect.h - clampedRadii.bottomRight;
-                    SDL_Clay_RenderArc(rendererData, (SDL_FPoint){centerX, centerY}, clampedRadii.bottomRight,
-                        0.0f, 90.0f, config->width.bottom, config->color);
-                }
-
+                if (config->color.a <= 0) break;
+                //like the original line-based borders, the outline sits 1px outside the element box
+                const SDL_FRect outline = { rect.x - 1, rect.y - 1, rect.w + 2, rect.h + 2 };
+                if (SDL_Clay_OverlapsText(&outline)) SDL_Clay_Flush(rendererData);
+                SDL_Clay_BatchBorder(outline, config);
             } break;
             case CLAY_RENDER_COMMAND_TYPE_SCISSOR_START: {
                 Clay_BoundingBox boundingBox = rcmd->boundingBox;
@@ -244,21 +306,42 @@ static void SDL_Clay_RenderClayCommands(Clay_SDL3RendererData *rendererData, Cla
                         .w = boundingBox.width,
                         .h = boundingBox.height,
                 };
-                SDL_SetRenderClipRect(rendererData->renderer, &currentClippingRectangle);
+                SDL_Clay_SetClip(rendererData, &currentClippingRectangle);
                 break;
             }
             case CLAY_RENDER_COMMAND_TYPE_SCISSOR_END: {
-                SDL_SetRenderClipRect(rendererData->renderer, NULL);
+                SDL_Clay_SetClip(rendererData, NULL);
                 break;
             }
             case CLAY_RENDER_COMMAND_TYPE_IMAGE: {
+                SDL_Clay_Flush(rendererData);
                 SDL_Texture *texture = (SDL_Texture *)rcmd->renderData.image.imageData;
                 const SDL_FRect dest = { rect.x, rect.y, rect.w, rect.h };
-                SDL_RenderTexture(rendererData->renderer, texture, NULL, &dest);
+                if (texture) {
+                    SDL_RenderTexture(rendererData->renderer, texture, NULL, &dest);
+                    clayBatch.drawCalls++;
+                }
                 break;
             }
             default:
                 SDL_Log("Unknown render command type: %d", rcmd->commandType);
         }
     }
+
+    SDL_Clay_Flush(rendererData);
+    //SDL_LOGGING=render=debug reports how well the batching works
+    SDL_LogDebug(SDL_LOG_CATEGORY_RENDER, "clay: %d commands in %d draw calls",
+                 (int)rcommands->length, clayBatch.drawCalls);
+}
+
+/* Releases the batch buffers and corner tables; the next frame allocates them again. */
+static void SDL_Clay_ShutdownRenderer(void) {
+    SDL_free(clayBatch.vertices);
+    SDL_free(clayBatch.indices);
+    SDL_free(clayBatch.texts);
+    SDL_zero(clayBatch);
+    for (int i = 0; i <= MAX_CIRCLE_SEGMENTS; i++) {
+        SDL_free(clayCornerTables[i]);
+        clayCornerTables[i] = NULL;
+    }
 }
@@ -0,0 +1,208 @@
+/*
+ * Throughput benchmark for tinyexpr as used by the plotter.
+ *
+ * For every expression in the corpus this reports the mean te_compile time,
+ * the number of heap allocations a compile performs and te_eval throughput
+ * over a sweep of x values. tinyexpr.c is built into this translation unit
+ * so its malloc/free can be counted without linker tricks.
+ *
+ * A second table compares each te_precision tier of the approximated
+ * builtins with libm: throughput and the largest relative error seen.
+ *
+ *   make -C external/tinyexpr bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+static unsigned long bench_allocs;
+
+static void *bench_malloc(size_t size)
+{
+    bench_allocs++;
+    return malloc(size);
+}
+
+#define malloc(size) bench_malloc(size)
+#include "tinyexpr.c"
+#undef malloc
+
+#include "../../implicit_mul.h"
+
+#define COMPILE_REPS    2000
+#define EVAL_SAMPLES    1000000
+
+typedef struct {
+    const char *category;
+    const char *expression;
+    int implicit;               // run through expand_implicit_mul first
+} BenchCase;
+
+static const BenchCase corpus[] = {
+    { "polynomial",   "x^2",                                      0 },
+    { "polynomial",   "3*x^3 - 2*x^2 + x - 7",                    0 },
+    { "polynomial",   "((((x*0.5+1)*x-2)*x+3)*x-4)*x+5",          0 },
+    { "nested trig",  "sin(cos(x))",                              0 },
+    { "nested trig",  "sin(x)*cos(2*x) + tan(x/3)",               0 },
+    { "nested trig",  "sin(cos(sin(cos(x))))",                    0 },
+    { "pow chain",    "x^2^0.5",                                  0 },
+    { "pow chain",    "pow(abs(x), 1.5) + pow(2, x)",             0 },
+    { "pow chain",    "exp(-x^2) * x^3^0.25",                     0 },
+    { "implicit mul", "2x",                                       1 },
+    { "implicit mul", "3x^2 - 2x + 1",                            1 },
+    { "implicit mul", "xsin(x) + 2(x+1)",                         1 },
+    { "implicit mul", "x(x-1)(x+1)exp(-x)",                       1 },
+};
+
+typedef struct {
+    const char *expression;
+    double lo, hi;              // sweep range for x
+} TierCase;
+
+/* ln, sqrt and pow with a non-integer exponent are libm at every tier, so they have no row. */
+static const TierCase tier_corpus[] = {
+    { "sin(x)",             -100, 100 },
+    { "cos(x)",             -100, 100 },
+    { "exp(x)",             -50,  50 },
+    { "log(x)",             1e-3, 1e3 },
+    { "x^3",                -100, 100 },
+    { "sin(x)*exp(-x/8)",   -10,  10 },
+};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* "(((x+1)+1)+1)..." or "sin(sin(...sin(x)))" of the given depth. */
+static char *deep_nesting(const char *open, const char *close, int depth)
+{
+    size_t len = strlen(open) * depth + 1 + strlen(close) * depth + 1;
+    char *s = malloc(len);
+    char *p = s;
+    for (int i = 0; i < depth; i++) p += sprintf(p, "%s", open);
+    *p++ = 'x';
+    for (int i = 0; i < depth; i++) p += sprintf(p, "%s", close);
+    *p = '\0';
+    return s;
+}
+
+static void run_case(const char *category, const char *source, int implicit)
+{
+    char *expression = implicit ? expand_implicit_mul(source) : strdup(source);
+    double x = 0;
+    te_variable vars[] = {{"x", &x}};
+    int err;
+
+    te_expr *n = te_compile(expression, vars, 1, &err);
+    if (!n) {
+        printf("%-13s %-40.40s  compile error at %d\n", category, source, err);
+        free(expression);
+        return;
+    }
+    te_free(n);
+
+    bench_allocs = 0;
+    double start = now_seconds();
+    for (int i = 0; i < COMPILE_REPS; i++) {
+        te_free(te_compile(expression, vars, 1, &err));
+    }
+    double compile_us = (now_seconds() - start) * 1e6 / COMPILE_REPS;
+    double allocs = (double)bench_allocs / COMPILE_REPS;
+
+    n = te_compile(expression, vars, 1, &err);
+    volatile double sink = 0;
+    start = now_seconds();
+    for (int i = 0; i < EVAL_SAMPLES; i++) {
+        x = -10.0 + 20.0 * i / EVAL_SAMPLES;
+        sink += te_eval(n);
+    }
+    double elapsed = now_seconds() - start;
+    (void)sink;
+    te_free(n);
+
+    printf("%-13s %-40.40s %10.2f %8.1f %10.2f\n",
+           category, source, compile_us, allocs, EVAL_SAMPLES / elapsed / 1e6);
+
+    free(expression);
+}
+
+static double eval_rate(te_expr *n, double *x, double lo, double hi)
+{
+    volatile double sink = 0;
+    double start = now_seconds();
+    for (int i = 0; i < EVAL_SAMPLES; i++) {
+        *x = lo + (hi - lo) * i / EVAL_SAMPLES;
+        sink += te_eval(n);
+    }
+    (void)sink;
+    return EVAL_SAMPLES / (now_seconds() - start) / 1e6;
+}
+
+static void run_tier_case(const TierCase *c)
+{
+    double x = 0;
+    te_variable vars[] = {{"x", &x}};
+    int err;
+
+    te_expr *exact = te_compile(c->expression, vars, 1, &err);
+    if (!exact) {
+        printf("%-20s compile error at %d\n", c->expression, err);
+        return;
+    }
+
+    printf("%-20s", c->expression);
+    for (int tier = TE_PRECISION_EXACT; tier <= TE_PRECISION_FAST; tier++) {
+        te_expr *n = te_compile_precision(c->expression, vars, 1, (te_precision)tier, &err);
+
+        double max_error = 0;
+        for (int i = 0; i < EVAL_SAMPLES; i += 7) {
+            x = c->lo + (c->hi - c->lo) * i / EVAL_SAMPLES;
+            double want = te_eval(exact);
+            double got = te_eval(n);
+            if (want != 0 && isfinite(want)) {
+                double error = fabs(got - want) / fabs(want);
+                if (error > max_error) max_error = error;
+            }
+        }
+
+        printf(" %10.2f %9.1e", eval_rate(n, &x, c->lo, c->hi), max_error);
+        te_free(n);
+    }
+    printf("\n");
+    te_free(exact);
+}
+
+int main(void)
+{
+    printf("%-13s %-40s %10s %8s %10s\n", "category", "expression", "compile us", "allocs", "Meval/s");
+
+    for (size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        run_case(corpus[i].category, corpus[i].expression, corpus[i].implicit);
+    }
+
+    static const int depths[] = { 16, 64, 256 };
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        char *parens = deep_nesting("(", "+1)", depths[i]);
+        char *trig = deep_nesting("sin(", ")", depths[i]);
+        char label[32];
+        snprintf(label, sizeof(label), "deep %d", depths[i]);
+        run_case(label, parens, 0);
+        run_case(label, trig, 0);
+        free(parens);
+        free(trig);
+    }
+
+    printf("\n%-20s %10s %9s %10s %9s %10s %9s\n", "builtin tiers",
+           "exact Me/s", "error", "high Me/s", "error", "fast Me/s", "error");
+    for (size_t i = 0; i < sizeof(tier_corpus) / sizeof(tier_corpus[0]); i++) {
+        run_tier_case(&tier_corpus[i]);
+    }
+
+    return 0;
+}
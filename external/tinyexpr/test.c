@@ -0,0 +1,405 @@
+/*
+ * Differential correctness suite for tinyexpr.
+ *
+ * Every expression is compiled once and compared with a hand-written C
+ * reference over a fixed set of edge inputs (signed zeros, NaN, infinities,
+ * huge and tiny magnitudes) and a seeded stream of random inputs. Any change
+ * to parsing, constant folding or the builtins that alters a result shows up
+ * here. The approximated builtins of each te_precision tier are checked
+ * against libm with that tier's tolerance.
+ *
+ *   make -C external/tinyexpr test
+ */
+
+#include "tinyexpr.h"
+#include "../../implicit_mul.h"
+#include "../../tier_check.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define RANDOM_INPUTS   20000
+#define REL_TOLERANCE   1e-12
+#define HIGH_TOLERANCE  1e-12
+#define FAST_TOLERANCE  1e-7
+
+static int checks;
+static int failures;
+
+typedef double (*Reference)(double x);
+
+typedef struct {
+    const char *expression;
+    int implicit;               // run through expand_implicit_mul first
+    Reference reference;
+} DiffCase;
+
+static double r_square(double x)      { return pow(x, 2); }
+static double r_poly(double x)        { return 3 * pow(x, 3) - 2 * pow(x, 2) + x - 7; }
+static double r_horner(double x)      { return ((((x * 0.5 + 1) * x - 2) * x + 3) * x - 4) * x + 5; }
+static double r_neg_pow(double x)     { return pow(-x, 2); }           /* -a^b = (-a)^b */
+static double r_pow_left(double x)    { return pow(pow(x, 2), 0.5); }  /* a^b^c = (a^b)^c */
+static double r_trig(double x)        { return sin(x) * cos(2 * x) + tan(x / 3); }
+static double r_nested(double x)      { return sin(cos(sin(cos(x)))); }
+static double r_gauss(double x)       { return exp(pow(-x, 2)); }      /* unary minus binds first */
+static double r_logs(double x)        { return log(fabs(x) + 1) + log10(fabs(x) + 1); }
+static double r_sqrt(double x)        { return sqrt(x) + sqrt(fabs(x)); }
+static double r_div(double x)         { return 1 / x - x / 3; }
+static double r_mod(double x)         { return fmod(x, 3); }
+static double r_hyper(double x)       { return sinh(x / 10) - cosh(x / 10) + tanh(x); }
+static double r_inverse(double x)     { return atan(x) + atan2(x, 2) + asin(x / 1e300) + acos(0); }
+static double r_rounding(double x)    { return floor(x) + ceil(x) - fabs(x); }
+static double r_constants(double x)   { return x * 3.14159265358979323846 + 2.71828182845904523536; }
+static double r_implicit(double x)    { return 3 * pow(x, 2) - 2 * x + 1; }
+static double r_implicit_fn(double x) { return x * sin(x) + 2 * (x + 1); }
+static double r_implicit_exp(double x){ return x * (x - 1) * (x + 1) * exp(-x); }
+static double r_log10(double x)       { return 2 * log10(fabs(x) + 1); }
+
+static const DiffCase cases[] = {
+    { "x^2",                                  0, r_square },
+    { "3*x^3 - 2*x^2 + x - 7",                0, r_poly },
+    { "((((x*0.5+1)*x-2)*x+3)*x-4)*x+5",      0, r_horner },
+    { "-x^2",                                 0, r_neg_pow },
+    { "x^2^0.5",                              0, r_pow_left },
+    { "sin(x)*cos(2*x) + tan(x/3)",           0, r_trig },
+    { "sin(cos(sin(cos(x))))",                0, r_nested },
+    { "exp(-x^2)",                            0, r_gauss },
+    { "ln(abs(x)+1) + log(abs(x)+1)",         0, r_logs },
+    { "sqrt(x) + sqrt(abs(x))",               0, r_sqrt },
+    { "1/x - x/3",                            0, r_div },
+    { "x%3",                                  0, r_mod },
+    { "sinh(x/10) - cosh(x/10) + tanh(x)",    0, r_hyper },
+    { "atan(x) + atan2(x, 2) + asin(x/1e300) + acos(0)", 0, r_inverse },
+    { "floor(x) + ceil(x) - abs(x)",          0, r_rounding },
+    { "x*pi + e",                             0, r_constants },
+    { "3x^2 - 2x + 1",                        1, r_implicit },
+    { "xsin(x) + 2(x+1)",                     1, r_implicit_fn },
+    { "x(x-1)(x+1)exp(-x)",                   1, r_implicit_exp },
+    { "2log10(abs(x)+1)",                     1, r_log10 },
+};
+
+static const double edge_inputs[] = {
+    0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 3.0, -3.0,
+    1e-300, -1e-300, 1e300, -1e300, 4.9e-324,
+    NAN, INFINITY, -INFINITY
+};
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static double random_input(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+
+    /* Mix plot-scale values with values spread over the whole exponent range. */
+    double unit = (rng_state >> 11) * (1.0 / 9007199254740992.0);
+    if (rng_state & 1) {
+        return (unit * 2 - 1) * 100;
+    }
+    return ldexp(unit * 2 - 1, (int)(rng_state >> 54) % 200 - 100);
+}
+
+static int same_result(double got, double want, double tolerance)
+{
+    if (isnan(want)) return isnan(got);
+    if (isinf(want)) return got == want;
+    if (want == got) return 1;
+    return fabs(got - want) <= tolerance * fabs(want);
+}
+
+static void check_tolerance(const char *what, double x, double got, double want, double tolerance)
+{
+    checks++;
+    if (!same_result(got, want, tolerance)) {
+        failures++;
+        if (failures <= 20) {
+            printf("FAIL %s at x=%.17g: got %.17g, want %.17g\n", what, x, got, want);
+        }
+    }
+}
+
+static void check(const char *what, double x, double got, double want)
+{
+    check_tolerance(what, x, got, want, REL_TOLERANCE);
+}
+
+static void run_case(const DiffCase *c)
+{
+    char *expression = c->implicit ? expand_implicit_mul(c->expression) : NULL;
+    double x = 0;
+    te_variable vars[] = {{"x", &x}};
+    int err;
+
+    te_expr *n = te_compile(expression ? expression : c->expression, vars, 1, &err);
+    if (!n) {
+        printf("FAIL %s: compile error at %d\n", c->expression, err);
+        failures++;
+        free(expression);
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(edge_inputs) / sizeof(edge_inputs[0]); i++) {
+        x = edge_inputs[i];
+        check(c->expression, x, te_eval(n), c->reference(x));
+    }
+
+    for (int i = 0; i < RANDOM_INPUTS; i++) {
+        x = random_input();
+        check(c->expression, x, te_eval(n), c->reference(x));
+    }
+
+    te_free(n);
+    free(expression);
+}
+
+static double r_sin(double x)         { return sin(x); }
+static double r_cos(double x)         { return cos(x); }
+static double r_exp(double x)         { return exp(x); }
+static double r_ln(double x)          { return log(x); }
+static double r_log(double x)         { return log10(x); }
+static double r_pow_frac(double x)    { return pow(fabs(x), 2.5); }
+static double r_pow_var(double x)     { return pow(fabs(x) + 1, x / 10); }
+static double r_cube(double x)        { return pow(x, 3); }
+static double r_inv_square(double x)  { return pow(x, -2); }
+static double r_sqrt_only(double x)   { return sqrt(x); }
+
+static const DiffCase tier_cases[] = {
+    { "sin(x)",                 0, r_sin },
+    { "cos(x)",                 0, r_cos },
+    { "exp(x)",                 0, r_exp },
+    { "ln(x)",                  0, r_ln },
+    { "log(x)",                 0, r_log },
+    { "pow(abs(x), 2.5)",       0, r_pow_frac },
+    { "pow(abs(x)+1, x/10)",    0, r_pow_var },
+    { "x^3",                    0, r_cube },
+    { "x^-2",                   0, r_inv_square },
+    { "sqrt(x)",                0, r_sqrt_only },
+};
+
+static void run_tier_case(const DiffCase *c, te_precision precision, double tolerance)
+{
+    double x = 0;
+    te_variable vars[] = {{"x", &x}};
+    int err;
+    char what[64];
+    snprintf(what, sizeof(what), "%s [%s]", c->expression, precision == TE_PRECISION_HIGH ? "high" : "fast");
+
+    te_expr *n = te_compile_precision(c->expression, vars, 1, precision, &err);
+    if (!n) {
+        printf("FAIL %s: compile error at %d\n", what, err);
+        failures++;
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(edge_inputs) / sizeof(edge_inputs[0]); i++) {
+        x = edge_inputs[i];
+        check_tolerance(what, x, te_eval(n), c->reference(x), tolerance);
+    }
+
+    for (int i = 0; i < RANDOM_INPUTS; i++) {
+        x = random_input();
+        check_tolerance(what, x, te_eval(n), c->reference(x), tolerance);
+    }
+
+    te_free(n);
+}
+
+static void test_interp(void)
+{
+    static const struct { const char *expression; double value; } constant_cases[] = {
+        { "1+2*3",          7 },
+        { "(1+2)*3",        9 },
+        { "2^3^2",          64 },
+        { "-2^2",           4 },
+        { "10%4",           2 },
+        { "fac(5)",         120 },
+        { "ncr(6,2)",       15 },
+        { "npr(6,2)",       30 },
+        { "log(1000)",      3 },
+        { "ln(e)",          1 },
+        { "pow(2, 10)",     1024 },
+        { "1,2,3",          3 },
+        { "1/0",            INFINITY },
+        { "-1/0",           -INFINITY },
+        { "sqrt(-1)",       NAN },
+        { "0/0",            NAN },
+    };
+
+    for (size_t i = 0; i < sizeof(constant_cases) / sizeof(constant_cases[0]); i++) {
+        int err;
+        double got = te_interp(constant_cases[i].expression, &err);
+        check(constant_cases[i].expression, 0, err ? NAN : got, constant_cases[i].value);
+    }
+
+    static const struct { const char *expression; int error; } error_cases[] = {
+        { "1+",     2 },
+        { "sin(",   4 },
+        { "(1",     2 },
+        { "1)",     2 },
+        { "foo",    3 },
+        { "atan2(1)", 8 },
+    };
+
+    for (size_t i = 0; i < sizeof(error_cases) / sizeof(error_cases[0]); i++) {
+        int err;
+        double got = te_interp(error_cases[i].expression, &err);
+        checks++;
+        if (err != error_cases[i].error || !isnan(got)) {
+            failures++;
+            printf("FAIL %s: error %d, want %d\n", error_cases[i].expression, err, error_cases[i].error);
+        }
+    }
+}
+
+static void test_split_invariant(void)
+{
+    double x = 0, a = 0, b = 0;
+    te_variable vars[] = {{"x", &x}, {"a", &a}, {"b", &b}};
+
+    static const struct { const char *expression; int deps; } dependency_cases[] = {
+        { "1+2",        0 },
+        { "sin(x)^2",   TE_DEPENDS_X },
+        { "a*b",        TE_DEPENDS_OTHER },
+        { "x+a",        TE_DEPENDS_X | TE_DEPENDS_OTHER },
+    };
+
+    for (size_t i = 0; i < sizeof(dependency_cases) / sizeof(dependency_cases[0]); i++) {
+        te_expr *n = te_compile(dependency_cases[i].expression, vars, 3, 0);
+        int deps = n ? te_dependencies(n, &x) : -1;
+        checks++;
+        if (deps != dependency_cases[i].deps) {
+            failures++;
+            printf("FAIL te_dependencies(\"%s\") = %d, want %d\n",
+                   dependency_cases[i].expression, deps, dependency_cases[i].deps);
+        }
+        te_free(n);
+    }
+
+    static const struct { const char *expression; int max_subtrees, moved; } split_cases[] = {
+        { "a*sin(x)+b*x^2",         8, 2 },
+        { "a*sin(x)+b*x^2",         1, 1 },
+        { "sin(x)*cos(x)+a",        8, 1 },    /* the product is the largest x-only subtree */
+        { "b*x",                    8, 0 },    /* a bare x stays */
+        { "sin(x)^2",               8, 0 },    /* nothing else is read */
+        { "exp(-x/a)*cos(2*x)",     8, 2 },    /* -x and cos(2*x) */
+    };
+
+    for (size_t i = 0; i < sizeof(split_cases) / sizeof(split_cases[0]); i++) {
+        const char *expression = split_cases[i].expression;
+        te_expr *full = te_compile(expression, vars, 3, 0);
+        te_expr *residual = te_compile(expression, vars, 3, 0);
+        double slots[8];
+        te_expr *subtrees[8];
+        int moved = residual ? te_split_invariant(residual, &x, slots, subtrees, split_cases[i].max_subtrees) : -1;
+        checks++;
+        if (moved != split_cases[i].moved) {
+            failures++;
+            printf("FAIL te_split_invariant(\"%s\", %d) moved %d, want %d\n",
+                   expression, split_cases[i].max_subtrees, moved, split_cases[i].moved);
+        }
+
+        for (int j = 0; j < RANDOM_INPUTS / 100; j++) {
+            x = random_input();
+            a = random_input();
+            b = random_input();
+            for (int k = 0; k < moved; k++) slots[k] = te_eval(subtrees[k]);
+            check(expression, x, te_eval(residual), te_eval(full));
+        }
+
+        for (int k = 0; k < moved; k++) te_free(subtrees[k]);
+        te_free(residual);
+        te_free(full);
+    }
+}
+
+static void test_tier_check(void)
+{
+    static const struct { const char *expression; double lo, hi; te_precision want; } tier_check_cases[] = {
+        { "sin(x - 1)*exp(-(x^2))",         -5,  5,  TE_PRECISION_FAST },
+        { "exp(-x/8)",                      -10, 10, TE_PRECISION_FAST },
+        { "cosh(x)-exp(x)/2",               15,  25, TE_PRECISION_HIGH },     /* exp_fast cancels to ~1 unit */
+        { "exp(x)*cos(x)+exp(x)*sin(x)",    30,  40, TE_PRECISION_EXACT },    /* no '-', still cancels */
+    };
+    const double tolerance = 0.5 / 50;      /* half a pixel at the default 50 px per unit */
+
+    for (size_t i = 0; i < sizeof(tier_check_cases) / sizeof(tier_check_cases[0]); i++) {
+        double x = 0;
+        te_variable vars[] = {{"x", &x}};
+        te_expr *trees[TE_PRECISION_FAST + 1];
+        for (int p = TE_PRECISION_EXACT; p <= TE_PRECISION_FAST; p++) {
+            trees[p] = te_compile_precision(tier_check_cases[i].expression, vars, 1, (te_precision)p, 0);
+        }
+
+        double samples[33];
+        for (int j = 0; j < 33; j++) {
+            samples[j] = tier_check_cases[i].lo + (tier_check_cases[i].hi - tier_check_cases[i].lo) * j / 32;
+        }
+        te_precision got = tier_check(TE_PRECISION_FAST, trees, &x, samples, 33, tolerance);
+        checks++;
+        if (got != tier_check_cases[i].want) {
+            failures++;
+            printf("FAIL tier_check(\"%s\") = %d, want %d\n", tier_check_cases[i].expression, got,
+                   tier_check_cases[i].want);
+        }
+
+        for (int p = TE_PRECISION_EXACT; p <= TE_PRECISION_FAST; p++) te_free(trees[p]);
+    }
+}
+
+static void test_implicit_mul(void)
+{
+    static const struct { const char *input, *output; } expand_cases[] = {
+        { "2x",             "2*x" },
+        { "3(x+1)",         "3*(x+1)" },
+        { "(x+1)(x-1)",     "(x+1)*(x-1)" },
+        { "xsin(x)",        "x*sin(x)" },
+        { "xy",             "x*y" },
+        { "2.5x",           "2.5*x" },
+        { "exp(x)",         "exp(x)" },
+        { "log10(x)",       "log10(x)" },
+        { "x^2",            "x^2" },
+        { "ax^2+bx",        "a*x^2+b*x" },
+        { "2ax",            "2*a*x" },
+        { "tx",             "t*x" },
+        { "sin(tx)",        "sin(t*x)" },
+        { "abs(x)",         "abs(x)" },
+        { "atan(x)",        "atan(x)" },
+        { "atan2(x,1)",     "atan2(x,1)" },
+        { "tan(t)",         "tan(t)" },
+        { "tanh(ax)",       "tanh(a*x)" },
+        { "a(x+1)",         "a*(x+1)" },
+    };
+
+    for (size_t i = 0; i < sizeof(expand_cases) / sizeof(expand_cases[0]); i++) {
+        char *out = expand_implicit_mul(expand_cases[i].input);
+        checks++;
+        if (strcmp(out, expand_cases[i].output) != 0) {
+            failures++;
+            printf("FAIL expand_implicit_mul(\"%s\") = \"%s\", want \"%s\"\n",
+                   expand_cases[i].input, out, expand_cases[i].output);
+        }
+        free(out);
+    }
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        run_case(&cases[i]);
+    }
+    for (size_t i = 0; i < sizeof(tier_cases) / sizeof(tier_cases[0]); i++) {
+        run_tier_case(&tier_cases[i], TE_PRECISION_HIGH, HIGH_TOLERANCE);
+        run_tier_case(&tier_cases[i], TE_PRECISION_FAST, FAST_TOLERANCE);
+    }
+    test_interp();
+    test_split_invariant();
+    test_tier_check();
+    test_implicit_mul();
+
+    printf("%d checks, %d failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
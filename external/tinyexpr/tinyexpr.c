@@ -42,6 +42,7 @@ For log = natural log uncomment the next line. */
 #include <stdio.h>
 #include <ctype.h>
 #include <limits.h>
+#include <stdint.h>
 
 #ifndef NAN
 #define NAN (0.0/0.0)
@@ -72,6 +73,7 @@ typedef struct state {
 
     const te_variable *lookup;
     int lookup_len;
+    te_precision precision;
 } state;
 
 
@@ -154,6 +156,190 @@ static double ncr(double n, double r) {
 }
 static double npr(double n, double r) {return ncr(n, r) * fac(r);}
 
+/* Approximated builtins for te_compile_precision.
+ *
+ * Arguments are range reduced on their bit pattern and the remainder goes
+ * through a fixed polynomial, so the only branches are fallbacks to libm for
+ * arguments outside the reduced range (huge, subnormal, negative, infinite or
+ * NaN). HIGH keeps roughly 1e-12 relative error, FAST roughly 1e-7.
+ * sqrt is not replaced: the correctly rounded hardware instruction is already
+ * cheaper than any polynomial. */
+
+#define TE_ROUND_MAGIC  6755399441055744.0          /* 1.5 * 2^52, rounds to nearest integer */
+#define TE_INV_LN2      1.44269504088896338700e+00
+#define TE_LN2_HI       6.93147180369123816490e-01  /* ln(2) split so k * TE_LN2_HI is exact */
+#define TE_LN2_LO       1.90821492927058770002e-10
+#define TE_INV_LN10     4.34294481903251827651e-01
+#define TE_SQRT2        1.41421356237309504880e+00
+#define TE_INV_PIO2     6.36619772367581343076e-01
+#define TE_PIO2_1       1.57079632673412561417e+00  /* pi/2 in 33-bit pieces (fdlibm) */
+#define TE_PIO2_2       6.07710050630396597660e-11
+#define TE_PIO2_3       2.02226624871116645580e-21
+#define TE_TRIG_MAX     1e5                         /* beyond this, libm does the reduction */
+
+typedef union {double d; uint64_t u;} te_bits;
+
+static double scale2(double p, int k) {
+    /* p * 2^k for k in [-1022, 1023]. */
+    te_bits b;
+    b.u = (uint64_t)(k + 1023) << 52;
+    return p * b.d;
+}
+
+/* 2^(j/32), correctly rounded. */
+static const double exp2_table[32] = {
+    0x1.0000000000000p+0, 0x1.059b0d3158574p+0, 0x1.0b5586cf9890fp+0, 0x1.11301d0125b51p+0,
+    0x1.172b83c7d517bp+0, 0x1.1d4873168b9aap+0, 0x1.2387a6e756238p+0, 0x1.29e9df51fdee1p+0,
+    0x1.306fe0a31b715p+0, 0x1.371a7373aa9cbp+0, 0x1.3dea64c123422p+0, 0x1.44e086061892dp+0,
+    0x1.4bfdad5362a27p+0, 0x1.5342b569d4f82p+0, 0x1.5ab07dd485429p+0, 0x1.6247eb03a5585p+0,
+    0x1.6a09e667f3bcdp+0, 0x1.71f75e8ec5f74p+0, 0x1.7a11473eb0187p+0, 0x1.82589994cce13p+0,
+    0x1.8ace5422aa0dbp+0, 0x1.93737b0cdc5e5p+0, 0x1.9c49182a3f090p+0, 0x1.a5503b23e255dp+0,
+    0x1.ae89f995ad3adp+0, 0x1.b7f76f2fb5e47p+0, 0x1.c199bdd85529cp+0, 0x1.cb720dcef9069p+0,
+    0x1.d5818dcfba487p+0, 0x1.dfc97337b9b5fp+0, 0x1.ea4afa2a490dap+0, 0x1.f50765b6e4540p+0,
+};
+
+static double exp_reduce(double x, int *k, double *scale) {
+    /* x = (32k + j) * ln(2)/32 + r, |r| <= ln(2)/64; returns r and 2^(j/32) in scale. */
+    const double kd = (x * (32 * TE_INV_LN2) + TE_ROUND_MAGIC) - TE_ROUND_MAGIC;
+    const int n = (int)kd;
+    *k = n >> 5;
+    *scale = exp2_table[n & 31];
+    return (x - kd * (TE_LN2_HI / 32)) - kd * (TE_LN2_LO / 32);
+}
+
+static double exp_fast(double x) {
+    if (!(fabs(x) < 708.0)) return exp(x);
+    int k;
+    double scale;
+    const double r = exp_reduce(x, &k, &scale);
+    const double p = 1 + r * (1 + r * (1.0 / 2 + r * (1.0 / 6)));
+    return scale2(scale * p, k);
+}
+
+static double log_reduce(double x, int *e) {
+    /* x = m * 2^e with m in [sqrt(2)/2, sqrt(2)); returns s = (m - 1) / (m + 1). */
+    te_bits b;
+    b.d = x;
+    *e = (int)(b.u >> 52) - 1023;
+    b.u = (b.u & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+    if (b.d >= TE_SQRT2) {
+        b.d *= 0.5;
+        ++*e;
+    }
+    const double f = b.d - 1;
+    return f / (2 + f);
+}
+
+static double log10_fast(double x) {
+    if (!(x >= 2.2250738585072014e-308) || x == INFINITY) return log10(x);
+    int e;
+    const double s = log_reduce(x, &e);
+    const double z = s * s;
+    const double logm = 2 * s * (1 + z * (1.0 / 3 + z * (1.0 / 5 + z * (1.0 / 7))));
+    return (e * TE_LN2_HI + (e * TE_LN2_LO + logm)) * TE_INV_LN10;
+}
+
+static double trig_reduce(double x, int *quadrant) {
+    /* x = k * pi/2 + r, |r| <= pi/4 */
+    const double kd = (x * TE_INV_PIO2 + TE_ROUND_MAGIC) - TE_ROUND_MAGIC;
+    *quadrant = (int)kd & 3;
+    return ((x - kd * TE_PIO2_1) - kd * TE_PIO2_2) - kd * TE_PIO2_3;
+}
+
+static double sin_poly_high(double r) {
+    const double z = r * r;
+    return r + r * z * (-1.0 / 6 + z * (1.0 / 120 + z * (-1.0 / 5040 + z * (1.0 / 362880 +
+           z * (-1.0 / 39916800 + z * (1.0 / 6227020800.0))))));
+}
+
+static double cos_poly_high(double r) {
+    const double z = r * r;
+    return 1 + z * (-1.0 / 2 + z * (1.0 / 24 + z * (-1.0 / 720 + z * (1.0 / 40320 +
+           z * (-1.0 / 3628800 + z * (1.0 / 479001600 + z * (-1.0 / 87178291200.0)))))));
+}
+
+static double sin_poly_fast(double r) {
+    const double z = r * r;
+    return r + r * z * (-1.0 / 6 + z * (1.0 / 120 + z * (-1.0 / 5040 + z * (1.0 / 362880))));
+}
+
+static double cos_poly_fast(double r) {
+    const double z = r * r;
+    return 1 + z * (-1.0 / 2 + z * (1.0 / 24 + z * (-1.0 / 720 + z * (1.0 / 40320))));
+}
+
+static double sin_high(double x) {
+    if (!(fabs(x) < TE_TRIG_MAX)) return sin(x);
+    int q;
+    const double r = trig_reduce(x, &q);
+    const double v = (q & 1) ? cos_poly_high(r) : sin_poly_high(r);
+    return (q & 2) ? -v : v;
+}
+
+static double cos_high(double x) {
+    if (!(fabs(x) < TE_TRIG_MAX)) return cos(x);
+    int q;
+    const double r = trig_reduce(x, &q);
+    const double v = (q & 1) ? sin_poly_high(r) : cos_poly_high(r);
+    return ((q + 1) & 2) ? -v : v;
+}
+
+static double sin_fast(double x) {
+    if (!(fabs(x) < TE_TRIG_MAX)) return sin(x);
+    int q;
+    const double r = trig_reduce(x, &q);
+    const double v = (q & 1) ? cos_poly_fast(r) : sin_poly_fast(r);
+    return (q & 2) ? -v : v;
+}
+
+static double cos_fast(double x) {
+    if (!(fabs(x) < TE_TRIG_MAX)) return cos(x);
+    int q;
+    const double r = trig_reduce(x, &q);
+    const double v = (q & 1) ? sin_poly_fast(r) : cos_poly_fast(r);
+    return ((q + 1) & 2) ? -v : v;
+}
+
+static double pow_int(double a, double b) {
+    /* Small integer exponents by repeated squaring: x^2, x^3 and friends are most of what gets plotted.
+       exp(b ln a) measured slower than libm pow, so every other exponent goes there. */
+    if (fabs(b) <= 64 && b == (int)b) {
+        int n = (int)b;
+        if (n < 0) {
+            a = 1 / a;
+            n = -n;
+        }
+        double result = 1;
+        while (n) {
+            if (n & 1) result *= a;
+            a *= a;
+            n >>= 1;
+        }
+        return result;
+    }
+    return pow(a, b);
+}
+
+static const struct {const void *exact, *high, *fast;} tiered_builtins[] = {
+    /* Only kernels that beat libm in benchmark.c; the rest stay exact at that tier. */
+    {cos, cos_high, cos_fast},
+    {exp, exp, exp_fast},
+    {log10, log10, log10_fast},
+    {pow, pow_int, pow_int},
+    {sin, sin_high, sin_fast},
+};
+
+static const void *tiered_builtin(const void *function, te_precision precision) {
+    if (precision == TE_PRECISION_EXACT) return function;
+    for (size_t i = 0; i < sizeof(tiered_builtins) / sizeof(tiered_builtins[0]); ++i) {
+        if (tiered_builtins[i].exact == function) {
+            return precision == TE_PRECISION_HIGH ? tiered_builtins[i].high : tiered_builtins[i].fast;
+        }
+    }
+    return function;
+}
+
+
 #ifdef _MSC_VER
 #pragma function (ceil)
 #pragma function (floor)
@@ -277,7 +463,7 @@ void next_token(state *s) {
                         case TE_FUNCTION0: case TE_FUNCTION1: case TE_FUNCTION2: case TE_FUNCTION3:     /* Falls through. */
                         case TE_FUNCTION4: case TE_FUNCTION5: case TE_FUNCTION6: case TE_FUNCTION7:     /* Falls through. */
                             s->type = var->type;
-                            s->function = var->address;
+                            s->function = tiered_builtin(var->address, s->precision);
                             break;
                     }
                 }
@@ -289,7 +475,7 @@ void next_token(state *s) {
                     case '-': s->type = TOK_INFIX; s->function = sub; break;
                     case '*': s->type = TOK_INFIX; s->function = mul; break;
                     case '/': s->type = TOK_INFIX; s->function = divide; break;
-                    case '^': s->type = TOK_INFIX; s->function = pow; break;
+                    case '^': s->type = TOK_INFIX; s->function = tiered_builtin(pow, s->precision); break;
                     case '%': s->type = TOK_INFIX; s->function = fmod; break;
                     case '(': s->type = TOK_OPEN; break;
                     case ')': s->type = TOK_CLOSE; break;
@@ -461,7 +647,7 @@ static te_expr *factor(state *s) {
 
     te_expr *insertion = 0;
 
-    while (s->type == TOK_INFIX && (s->function == pow)) {
+    while (s->type == TOK_INFIX && (s->function == tiered_builtin(pow, s->precision))) {
         te_fun2 t = s->function;
         next_token(s);
 
@@ -505,7 +691,7 @@ static te_expr *factor(state *s) {
     te_expr *ret = power(s);
     CHECK_NULL(ret);
 
-    while (s->type == TOK_INFIX && (s->function == pow)) {
+    while (s->type == TOK_INFIX && (s->function == tiered_builtin(pow, s->precision))) {
         te_fun2 t = s->function;
         next_token(s);
         te_expr *p = power(s);
@@ -663,10 +849,17 @@ static void optimize(te_expr *n) {
 
 
 te_expr *te_compile(const char *expression, const te_variable *variables, int var_count, int *error) {
+    return te_compile_precision(expression, variables, var_count, TE_PRECISION_EXACT, error);
+}
+
+
+te_expr *te_compile_precision(const char *expression, const te_variable *variables, int var_count,
+                              te_precision precision, int *error) {
     state s;
     s.start = s.next = expression;
     s.lookup = variables;
     s.lookup_len = var_count;
+    s.precision = precision;
 
     next_token(&s);
     te_expr *root = list(&s);
@@ -690,6 +883,54 @@ te_expr *te_compile(const char *expression, const te_variable *variables, int va
 }
 
 
+int te_dependencies(const te_expr *n, const double *x) {
+    if (TYPE_MASK(n->type) == TE_VARIABLE) return n->bound == x ? TE_DEPENDS_X : TE_DEPENDS_OTHER;
+    if (TYPE_MASK(n->type) == TE_CONSTANT) return 0;
+
+    int deps = IS_PURE(n->type) ? 0 : TE_DEPENDS_OTHER;
+    for (int i = 0; i < ARITY(n->type); ++i) {
+        deps |= te_dependencies(n->parameters[i], x);
+    }
+    return deps;
+}
+
+
+static int split_invariant(te_expr *n, const double *x, const double *slots, te_expr **subtrees,
+                           int max_subtrees, int *count) {
+    if (TYPE_MASK(n->type) == TE_VARIABLE) return n->bound == x ? TE_DEPENDS_X : TE_DEPENDS_OTHER;
+    if (TYPE_MASK(n->type) == TE_CONSTANT) return 0;
+
+    const int arity = ARITY(n->type);
+    int child[7];
+    int deps = IS_PURE(n->type) ? 0 : TE_DEPENDS_OTHER;
+    for (int i = 0; i < arity; ++i) {
+        child[i] = split_invariant(n->parameters[i], x, slots, subtrees, max_subtrees, count);
+        deps |= child[i];
+    }
+    /* An x-only node is left whole for the first ancestor that reads something else. */
+    if (!(deps & TE_DEPENDS_OTHER)) return deps;
+
+    for (int i = 0; i < arity && *count < max_subtrees; ++i) {
+        te_expr *sub = n->parameters[i];
+        if (child[i] != TE_DEPENDS_X || ARITY(sub->type) == 0) continue;
+
+        te_expr *slot = new_expr(TE_VARIABLE, 0);
+        if (!slot) break;
+        slot->bound = &slots[*count];
+        subtrees[(*count)++] = sub;
+        n->parameters[i] = slot;
+    }
+    return deps;
+}
+
+
+int te_split_invariant(te_expr *n, const double *x, const double *slots, te_expr **subtrees, int max_subtrees) {
+    int count = 0;
+    split_invariant(n, x, slots, subtrees, max_subtrees, &count);
+    return count;
+}
+
+
 double te_interp(const char *expression, int *error) {
     te_expr *n = te_compile(expression, 0, 0, error);
 
@@ -60,6 +60,14 @@ typedef struct te_variable {
 } te_variable;
 
 
+/* Accuracy of the sin, cos, exp, log10 and pow builtins; the others are always libm. */
+typedef enum te_precision {
+    TE_PRECISION_EXACT,     /* libm */
+    TE_PRECISION_HIGH,      /* ~1e-12 relative */
+    TE_PRECISION_FAST       /* ~1e-7 relative */
+} te_precision;
+
+
 
 /* Parses the input expression, evaluates it, and frees it. */
 /* Returns NaN on error. */
@@ -69,9 +77,27 @@ double te_interp(const char *expression, int *error);
 /* Returns NULL on error. */
 te_expr *te_compile(const char *expression, const te_variable *variables, int var_count, int *error);
 
+/* Same as te_compile, but binds approximated builtins of the given precision. */
+te_expr *te_compile_precision(const char *expression, const te_variable *variables, int var_count,
+                              te_precision precision, int *error);
+
 /* Evaluates the expression. */
 double te_eval(const te_expr *n);
 
+/* What te_dependencies reports for a tree, given the address x is bound to. */
+enum {
+    TE_DEPENDS_X = 1,       /* reads x */
+    TE_DEPENDS_OTHER = 2    /* reads any other variable, or calls an impure function */
+};
+
+int te_dependencies(const te_expr *n, const double *x);
+
+/* Moves the largest subtrees of n that depend only on x out into subtrees and
+   replaces each with a read of slots[i], at most max_subtrees of them. Only
+   subtrees under a node that also reads something else are moved, and a bare x
+   never is. Returns how many were moved; the caller frees them with te_free. */
+int te_split_invariant(te_expr *n, const double *x, const double *slots, te_expr **subtrees, int max_subtrees);
+
 /* Prints debugging information on the syntax tree. */
 void te_print(const te_expr *n);
 
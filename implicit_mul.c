@@ -0,0 +1,58 @@
+#include "implicit_mul.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/* Single-letter variables: x, y and the graph parameters (GRAPH_PARAM_NAMES in main.c). */
+static const char IMPLICIT_MUL_VARS[] = "xytab";
+
+/* True if src[i..] starts a run of letters that are all variables, like "ax" or "tx". */
+static bool implicit_mul_vars_only(const char *src, size_t i, size_t len)
+{
+    for (; i < len && isalpha((unsigned char)src[i]); i++) {
+        if (!strchr(IMPLICIT_MUL_VARS, src[i])) return false;
+    }
+    return true;
+}
+
+/* Rewrites "2x", "3(x+1)", "xsin(x)", "xy" and "2ax" into forms tinyexpr understands.
+   A run of letters made only of variables is split into single letters, and a
+   leading x or y always is; any other run of letters and digits is a name and
+   is copied untouched, so "exp", "log10", "abs", "atan" and "tan" survive.
+   Returns a malloc'd string the caller frees. */
+char *expand_implicit_mul(const char *src)
+{
+    size_t len = strlen(src);
+    char *out = malloc(len * 2 + 1);
+    if (!out) return NULL;
+    char *p = out;
+
+    size_t i = 0;
+    while (i < len) {
+        char c = src[i];
+        bool left;
+
+        if (c == 'x' || c == 'y' || (isalpha((unsigned char)c) && implicit_mul_vars_only(src, i, len))) {
+            *p++ = src[i++];
+            left = true;
+        } else if (isalpha(c)) {
+            while (i < len && (isalnum(src[i]) || src[i] == '_')) *p++ = src[i++];
+            left = false;
+        } else {
+            *p++ = src[i++];
+            left = isdigit(c) || c == ')';
+        }
+
+        if (left && i < len) {
+            char n = src[i];
+            bool right = n == '(' || isalpha(n);
+
+            if (right)
+                *p++ = '*';
+        }
+    }
+    *p = '\0';
+    return out;
+}
@@ -0,0 +1,9 @@
+#ifndef IMPLICIT_MUL_H
+#define IMPLICIT_MUL_H
+
+/* Rewrites implicit products such as "2x", "3(x+1)", "xsin(x)" and "2ax" into
+   forms tinyexpr understands. Returns a malloc'd string the caller frees, or
+   NULL when out of memory. */
+char *expand_implicit_mul(const char *src);
+
+#endif
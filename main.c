@@ -1,13 +1,27 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <ctype.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
 #define SDL_MAIN_USE_CALLBACKS
 #include <SDL3/SDL_main.h>
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
 #include "external/tinyexpr/tinyexpr.h"
+#include "implicit_mul.h"
+#include "tier_check.h"
 
 #define CLAY_IMPLEMENTATION
 #include "external/clay/clay.h"
@@ -35,21 +49,332 @@ typedef struct {
     double x, y;
 } Vec2d;
 
+typedef enum {
+    GRAPH_MODE_CURVE,   // y = f(x)
+    GRAPH_MODE_FIELD    // heatmap and contours of f(x, y)
+} GraphMode;
+
+/* Named parameters bound next to x and y. t is advanced by the animation clock,
+   all of them can be dragged on their sliders. Keep IMPLICIT_MUL_VARS in
+   implicit_mul.c in step so "2ax" reads as 2*a*x. */
+#define GRAPH_PARAM_COUNT 3
+#define GRAPH_VAR_MAX     (2 + GRAPH_PARAM_COUNT)
+
+static const char *const GRAPH_PARAM_NAMES[GRAPH_PARAM_COUNT] = { "t", "a", "b" };
+static const double GRAPH_PARAM_MIN[GRAPH_PARAM_COUNT]      = { 0.0, -5.0, -5.0 };
+static const double GRAPH_PARAM_MAX[GRAPH_PARAM_COUNT]      = { 10.0, 5.0, 5.0 };
+static const double GRAPH_PARAM_DEFAULT[GRAPH_PARAM_COUNT]  = { 0.0, 1.0, 1.0 };
+
+/* Everything the render thread needs to produce one frame, copied by value
+   so the main thread can keep mutating GraphState while a frame is in flight. */
+typedef struct {
+    char function[256];
+    GraphMode mode;
+    Viewport viewport;
+    int width, height;
+    bool integral;      // shade and integrate over [ia, ib]
+    double ia, ib;
+    te_precision precision;     // builtins used for drawing; the integral value is always exact
+    bool check_precision;       // precision is a guess from plot_precision, see checked_precision
+    double params[GRAPH_PARAM_COUNT];
+} GraphJob;
+
+/* A job is stale once a newer one has been submitted. */
+typedef struct {
+    SDL_AtomicInt *generation;
+    int expected;
+} RenderCancel;
+
+/* worker is in [0, thread_count]; the calling thread runs as worker thread_count. */
+typedef void (*WorkerTask)(void *userdata, int index, int worker);
+
+typedef struct WorkerPool WorkerPool;
+
+typedef struct {
+    WorkerPool *pool;
+    int id;
+} WorkerThreadArgs;
+
+struct WorkerPool {
+    SDL_Thread **threads;
+    WorkerThreadArgs *args;
+    int thread_count;
+    SDL_Mutex *run_lock;    // serializes worker_pool_run callers
+    SDL_Mutex *lock;
+    SDL_Condition *start;
+    SDL_Condition *done;
+    WorkerTask task;
+    void *userdata;
+    int count;
+    SDL_AtomicInt next;
+    int active;
+    Uint32 batch;
+    bool quit;
+};
+
+#define FIELD_TILE_SIZE       64    // 64x64 floats = 16 KiB, stays in L1/L2 while a tile is filled
+#define FIELD_CACHE_TILES     1024  // minimum; grown to twice the visible tiles (a 4K viewport shows 60x34)
+#define FIELD_CONTOUR_STEP    4     // pixels between marching-squares samples
+#define FIELD_CONTOUR_LEVELS  10
+
+/* Tiles live on the global pixel lattice (world = pixel / scale), so panning
+   only shifts which tiles are visible and reuses everything already computed. */
+typedef struct {
+    bool keyed;             // tx, ty and scale are set and the tile is in the hash index
+    bool valid;             // values are computed
+    double xScale, yScale;
+    Sint64 tx, ty;
+    Uint64 last_used;
+    int hash_next;          // next tile in the same bucket, -1 = end
+    int lru_prev, lru_next; // recency list, head = most recently used
+    float values[FIELD_TILE_SIZE * FIELD_TILE_SIZE];
+} FieldTile;
+
+typedef struct {
+    int tiles_visible;
+    int tiles_evaluated;
+    Uint64 evaluations;
+    double eval_ms;
+    double total_ms;
+} FieldStats;
+
+typedef struct {
+    WorkerPool *pool;
+    FieldTile *tiles;
+    int capacity;
+    int *buckets;           // hash index heads, -1 = empty
+    int bucket_mask;
+    int lru_head, lru_tail;
+    char function[256];     // tiles are only valid for this expression
+    te_precision precision; // ... evaluated with these builtins
+    double params[GRAPH_PARAM_COUNT];   // ... and parameter values
+    Uint64 frame;
+} FieldRenderer;
+
+#define INTEGRAL_CACHE_SIZE     4096    // power of two
+#define INTEGRAL_PANELS_PER_GRID 8      // cached panels per visible grid step
+#define INTEGRAL_MAX_DEPTH      16
+#define INTEGRAL_TOL_PER_UNIT   1e-10
+#define INTEGRAL_REL_TOL        1e-12
+
+/* Result of integrating one panel of the fixed lattice [k * width, (k + 1) * width]. */
+typedef struct {
+    bool used;
+    Sint64 panel;
+    double value;
+    double error;
+    int evaluations;
+} IntegralPanel;
+
+typedef struct {
+    double value;
+    double error;
+    Uint64 evaluations;     // this frame only, cached panels cost nothing
+    int panels;
+    int panels_computed;
+    double ms;
+    bool valid;
+} IntegralStats;
+
+/* Panels are aligned to a lattice that only depends on the zoom level, so
+   dragging an endpoint recomputes the two partial end panels and whatever
+   full panels it newly covers. */
+typedef struct {
+    WorkerPool *pool;
+    IntegralPanel *panels;
+    int count;
+    char function[256];     // panels are only valid for this expression
+    double panel_width;     // ... and this lattice
+    double params[GRAPH_PARAM_COUNT];   // ... and parameter values
+} IntegralCache;
+
+#define EXPR_CACHE_SIZE 32
+
+typedef struct {
+    char source[256];       // expression as typed, before expand_implicit_mul
+    te_precision precision;
+    te_expr *expr;
+    Uint64 last_used;       // 0 = free slot
+} ExprCacheEntry;
+
+/* LRU of compiled y = f(x) expressions. Every entry is bound to the cache's own
+   x and parameters, so an expression is only evaluated by the thread that owns the cache. */
+typedef struct {
+    double x;
+    double params[GRAPH_PARAM_COUNT];
+    ExprCacheEntry entries[EXPR_CACHE_SIZE];
+    Uint64 clock;
+    Uint64 hits, misses;
+} ExprCache;
+
+#define SUBTREE_SLOTS 16
+
+/* Values of the x-only subtrees of a parameterized y = f(x), one row per sample
+   column. When only a parameter changes, just the residual tree is evaluated:
+   f compiled on its own x with te_split_invariant moving those subtrees into slots.
+   The rows are rebuilt when the function, tier or horizontal sampling changes. */
+typedef struct {
+    char function[256];
+    te_precision precision;
+    double cx, xScale;
+    int width;
+    te_expr *residual;      // NULL = no rows
+    double x;
+    double params[GRAPH_PARAM_COUNT];
+    double slots[SUBTREE_SLOTS];
+    int slot_count;
+    double *columns;        // width rows of slot_count values
+} SubtreeCache;
+
+/* Per-renderer state that survives between frames; only the thread rendering touches it. */
+typedef struct {
+    FieldRenderer field;
+    IntegralCache integral;
+    ExprCache exprs;
+    SubtreeCache subtrees;
+} GraphCaches;
+
+typedef struct {
+    FieldStats field;
+    IntegralStats integral;
+    bool expression_error;      // the function did not compile, the frame only has axes
+} FrameStats;
+
+typedef struct {
+    SDL_Thread *thread;
+    SDL_Mutex *lock;
+    SDL_Condition *wake;
+    TTF_Font *label_font;       // private instance, TTF fonts are not thread safe
+    GraphJob pending;
+    bool has_pending;
+    GraphJob running;           // valid while busy
+    bool busy;
+    bool quit;
+    SDL_AtomicInt generation;
+    SDL_Surface *completed;     // back buffer, picked up by the main thread
+    WorkerPool pool;
+    GraphCaches caches;
+    FrameStats stats;           // stats of the frame in completed, or of the last one taken
+} GraphRenderer;
+
 typedef struct {
-    SDL_Texture *graph_texture;
+    SDL_Texture *graph_texture; // front buffer
+    GraphRenderer renderer;
     Viewport viewport;
     Vec2d velocity;
     char function[256];
+    GraphMode mode;
+    FrameStats stats;           // timings of the frame currently on screen
+    bool show_integral;
+    double integral_a, integral_b;
+    int dragging_bound;         // 0 = a, 1 = b, -1 = none
+    bool precision_auto;        // pick the tier per frame with plot_precision
+    te_precision precision;     // fixed tier from --precision
+    double params[GRAPH_PARAM_COUNT];
+    bool animating;             // advance t every frame
+    int dragging_param;         // slider being dragged, -1 = none
     bool needs_update;
     int mouseX, mouseY;
     bool mouse_in_window;
 } GraphState;
 
+typedef enum {
+    TRACE_NONE,
+    TRACE_RECORD,
+    TRACE_REPLAY
+} TraceMode;
+
+/* Input trace for reproducing slow frames: events, the polled key state and
+   dt of every frame, and the resulting viewport for verification on replay. */
+typedef struct {
+    TraceMode mode;
+    FILE *file;
+    Uint64 frame;
+    int width, height;      // replay has no window, so the window size is tracked here
+} InputTrace;
+
+#ifdef _WIN32
+typedef SOCKET ServeSocket;
+#define SERVE_INVALID_SOCKET INVALID_SOCKET
+#define serve_close_socket closesocket
+#else
+typedef int ServeSocket;
+#define SERVE_INVALID_SOCKET (-1)
+#define serve_close_socket close
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define SERVE_SEND_FLAGS MSG_NOSIGNAL   // a client hanging up must not kill the daemon
+#else
+#define SERVE_SEND_FLAGS 0
+#endif
+
+#define SERVE_QUEUE_SIZE    64          // accepted connections waiting for a worker
+#define SERVE_IMAGE_CACHE   64          // encoded replies kept for repeated requests
+#define SERVE_CACHE_BYTES   (64 << 20)
+#define SERVE_LATENCY_RING  4096
+#define SERVE_MAX_SIZE      4096        // largest width or height a client may ask for
+#define SERVE_IDLE_MS       5000        // a request line must arrive within this, or the worker is freed
+
+typedef struct {
+    char key[512];          // normalized request line
+    Uint8 *data;
+    size_t size;
+    int width, height;
+    Uint64 last_used;       // 0 = free slot
+} ServeImage;
+
+/* State shared by the --serve accept loop and its client workers. */
+typedef struct {
+    const GraphState *settings; // precision from the command line, parameter defaults
+    char path[108];
+
+    SDL_Mutex *lock;            // guards everything below
+    SDL_Condition *pending;
+    ServeSocket queue[SERVE_QUEUE_SIZE];
+    int queue_head, queue_count;
+    bool quit;
+
+    ServeImage images[SERVE_IMAGE_CACHE];
+    size_t image_bytes;
+    Uint64 clock;
+
+    Uint64 requests, errors;
+    Uint64 image_hits, image_misses;
+    Uint64 expr_hits, expr_misses;      // ExprCache counters, added after each render
+    Uint64 tiles_visible, tiles_evaluated;
+    double latency_ms[SERVE_LATENCY_RING];
+    Uint64 latency_count;
+} PlotServer;
+
+/* One --serve connection worker. It owns a font and warm caches, so cache misses
+   render concurrently; only the worker pool is shared. */
+typedef struct {
+    PlotServer *server;
+    SDL_Thread *thread;
+    TTF_Font *label_font;
+    GraphCaches caches;
+} ServeWorker;
+
+typedef struct {
+    ServeSocket socket;
+    char buffer[1024];
+    size_t start, length;
+} ServeConnection;
+
+typedef enum {
+    SERVE_READ_LINE,
+    SERVE_READ_CLOSED,      // EOF or socket error
+    SERVE_READ_TOO_LONG,
+    SERVE_READ_IDLE         // no complete line within SERVE_IDLE_MS
+} ServeRead;
+
 typedef struct app_state {
     SDL_Window *window;
     Clay_SDL3RendererData rendererData;
     ClayVideoDemo_Data demoData;
     GraphState graphState;
+    InputTrace trace;
 } AppState;
 
 SDL_Texture *sample_image;
@@ -76,62 +401,200 @@ static inline Vec2d screen_to_math(const Viewport *v, int sx, int sy, int width,
     return p;
 }
 
-char *expand_implicit_mul(const char *src)
+static inline bool render_cancelled(const RenderCancel *cancel)
 {
-    size_t len = strlen(src);
-    char *out = malloc(len * 2 + 1);
-    char *p = out;
-
-    for (size_t i = 0; i < len; i++) {
-        char c = src[i];
-        *p++ = c;
-
-        if (i + 1 < len) {
-            char n = src[i + 1];
+    return cancel && SDL_GetAtomicInt(cancel->generation) != cancel->expected;
+}
 
-            bool left  = isdigit(c) || c == ')' || c == 'x';
-            bool right = n == '(' || n == 'x' || isalpha(n);
+/* Fills vars with x, y (fields only, y may be NULL) and the named parameters. Returns the count. */
+static int graph_vars(te_variable *vars, const double *x, const double *y, const double *params)
+{
+    int count = 0;
+    vars[count++] = (te_variable) { "x", x };
+    if (y) vars[count++] = (te_variable) { "y", y };
+    for (int i = 0; i < GRAPH_PARAM_COUNT; i++) {
+        vars[count++] = (te_variable) { GRAPH_PARAM_NAMES[i], &params[i] };
+    }
+    return count;
+}
 
-            if (left && right)
-                *p++ = '*';
+/* Compiled func bound to cache->x and cache->params, or NULL if it does not parse. The cache keeps ownership. */
+static te_expr *expr_cache_get(ExprCache *cache, const char *func, te_precision precision)
+{
+    ExprCacheEntry *victim = &cache->entries[0];
+    cache->clock++;
+
+    for (int i = 0; i < EXPR_CACHE_SIZE; i++) {
+        ExprCacheEntry *e = &cache->entries[i];
+        if (e->last_used && e->precision == precision && strcmp(e->source, func) == 0) {
+            e->last_used = cache->clock;
+            cache->hits++;
+            return e->expr;
         }
+        if (e->last_used < victim->last_used) victim = e;
     }
-    *p = '\0';
-    return out;
+    cache->misses++;
+
+    te_variable vars[GRAPH_VAR_MAX];
+    const int var_count = graph_vars(vars, &cache->x, NULL, cache->params);
+    int err;
+    char *expanded = expand_implicit_mul(func);
+    te_expr *expr = expanded ? te_compile_precision(expanded, vars, var_count, precision, &err) : NULL;
+    free(expanded);
+    if (!expr) return NULL;
+
+    te_free(victim->expr);
+    SDL_strlcpy(victim->source, func, sizeof(victim->source));
+    victim->precision = precision;
+    victim->expr = expr;
+    victim->last_used = cache->clock;
+    return expr;
 }
 
-int drawGraph(SDL_Renderer *r, const Viewport *v, const char *func, int width, int height)
+void expr_cache_destroy(ExprCache *cache)
 {
-    const int samples = width;
-    SDL_FPoint *points = malloc(sizeof(SDL_FPoint) * samples);
-    if (!points) return -1;
+    for (int i = 0; i < EXPR_CACHE_SIZE; i++) te_free(cache->entries[i].expr);
+    SDL_zerop(cache);
+}
 
-    double halfW = (width / 2.0) / v->xScale;
+/* x of sample column i when a curve is drawn with one sample per pixel column. */
+static inline double sample_x(const Viewport *v, int i, int samples)
+{
+    double halfW = (samples / 2.0) / v->xScale;
     double xMin = v->cx - halfW;
     double xMax = v->cx + halfW;
+    double t = (double)i / (samples - 1);
+    return xMin + t * (xMax - xMin);
+}
 
-    double x;
-    te_variable vars[] = {{"x", &x}};
-    int err;
+void subtree_cache_clear(SubtreeCache *sc)
+{
+    te_free(sc->residual);
+    free(sc->columns);
+    sc->residual = NULL;
+    sc->columns = NULL;
+    sc->slot_count = 0;
+}
+
+/* Residual tree of func for this sampling, rebuilding the rows when the function,
+   tier or horizontal sampling changed since the last frame. Returns NULL if the
+   residual does not compile or the rows do not fit. */
+static te_expr *subtree_cache_prepare(SubtreeCache *sc, const char *func, te_precision precision,
+                                      const Viewport *v, int samples)
+{
+    if (sc->residual && sc->precision == precision && sc->width == samples &&
+        sc->cx == v->cx && sc->xScale == v->xScale && strcmp(sc->function, func) == 0) {
+        return sc->residual;
+    }
+    subtree_cache_clear(sc);
 
+    te_variable vars[GRAPH_VAR_MAX];
+    const int var_count = graph_vars(vars, &sc->x, NULL, sc->params);
+    int err;
     char *expanded = expand_implicit_mul(func);
-    te_expr *expr = te_compile(expanded, vars, 1, &err);
+    te_expr *residual = expanded ? te_compile_precision(expanded, vars, var_count, precision, &err) : NULL;
     free(expanded);
+    if (!residual) return NULL;
 
-    if (!expr || err) {
+    te_expr *subtrees[SUBTREE_SLOTS];
+    sc->slot_count = te_split_invariant(residual, &sc->x, sc->slots, subtrees, SUBTREE_SLOTS);
+
+    sc->columns = malloc(sizeof(double) * samples * SDL_max(sc->slot_count, 1));
+    for (int i = 0; sc->columns && i < samples; i++) {
+        sc->x = sample_x(v, i, samples);
+        for (int k = 0; k < sc->slot_count; k++) {
+            sc->columns[(size_t)i * sc->slot_count + k] = te_eval(subtrees[k]);
+        }
+    }
+    for (int k = 0; k < sc->slot_count; k++) te_free(subtrees[k]);
+    if (!sc->columns) {
+        te_free(residual);
+        sc->slot_count = 0;
+        return NULL;
+    }
+
+    SDL_strlcpy(sc->function, func, sizeof(sc->function));
+    sc->precision = precision;
+    sc->cx = v->cx;
+    sc->xScale = v->xScale;
+    sc->width = samples;
+    sc->residual = residual;
+    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "subtrees: %d x-only subtrees cached over %d columns",
+                 sc->slot_count, samples);
+    return residual;
+}
+
+#define PRECISION_CHECK_SAMPLES 33
+
+/* The job's tier, or a more exact one if the curve of the guessed tier misses
+   the exact curve by more than half a pixel at any of a few evenly spaced
+   columns. The guess only bounds the error relative to y, which says nothing
+   once terms cancel. */
+static te_precision checked_precision(ExprCache *exprs, const GraphJob *job)
+{
+    if (!job->check_precision || job->precision == TE_PRECISION_EXACT) return job->precision;
+
+    SDL_memcpy(exprs->params, job->params, sizeof(exprs->params));
+    te_expr *trees[TE_PRECISION_FAST + 1];
+    for (int p = TE_PRECISION_EXACT; p <= (int)job->precision; p++) {
+        trees[p] = expr_cache_get(exprs, job->function, (te_precision)p);
+        if (!trees[p]) return job->precision;
+    }
+
+    double samples[PRECISION_CHECK_SAMPLES];
+    for (int i = 0; i < PRECISION_CHECK_SAMPLES; i++) {
+        samples[i] = sample_x(&job->viewport, i * (job->width - 1) / (PRECISION_CHECK_SAMPLES - 1), job->width);
+    }
+    return tier_check(job->precision, trees, &exprs->x, samples, PRECISION_CHECK_SAMPLES,
+                      0.5 / job->viewport.yScale);
+}
+
+#define GRAPH_EXPRESSION_ERROR (-2)
+
+/* Returns 0, -1 on allocation failure or cancellation, or GRAPH_EXPRESSION_ERROR. */
+int drawGraph(SDL_Renderer *r, const Viewport *v, ExprCache *exprs, SubtreeCache *subtrees, const char *func,
+              const double *params, int width, int height, te_precision precision, const RenderCancel *cancel)
+{
+    const int samples = width;
+    SDL_FPoint *points = malloc(sizeof(SDL_FPoint) * samples);
+    if (!points) return -1;
+
+    te_expr *expr = expr_cache_get(exprs, func, precision);
+    if (!expr) {
         SDL_Log("Expression error");
         free(points);
-        return -1;
+        return GRAPH_EXPRESSION_ERROR;
+    }
+    SDL_memcpy(exprs->params, params, sizeof(exprs->params));
+
+    // With parameters in play only the residual is evaluated; x-only parts come from the rows.
+    SubtreeCache *split = NULL;
+    if (te_dependencies(expr, &exprs->x) & TE_DEPENDS_OTHER) {
+        te_expr *residual = subtree_cache_prepare(subtrees, func, precision, v, samples);
+        if (residual) {
+            split = subtrees;
+            expr = residual;
+            SDL_memcpy(split->params, params, sizeof(split->params));
+        }
     }
 
     for (int i = 0; i < samples; i++) {
-        double t = (double)i / (samples - 1);
-        x = xMin + t * (xMax - xMin);
+        if ((i & 255) == 0 && render_cancelled(cancel)) {
+            free(points);
+            return -1;
+        }
+        double x = sample_x(v, i, samples);
+        if (split) {
+            split->x = x;
+            SDL_memcpy(split->slots, split->columns + (size_t)i * split->slot_count,
+                       sizeof(double) * split->slot_count);
+        } else {
+            exprs->x = x;
+        }
         double y = te_eval(expr);
         points[i] = math_to_screen(v, x, y, width, height);
     }
 
-    te_free(expr);
     SDL_RenderLines(r, points, samples);
     free(points);
     return 0;
@@ -194,16 +657,17 @@ void draw_axes(SDL_Renderer *r, const Viewport *v, int width, int height)
     SDL_RenderLines(r, yAxis, 2);
 }
 
-double numerical_derivative(const char *func, double x0)
+double numerical_derivative(const char *func, const double *params, double x0)
 {
     const double h = 1e-7;
     
     double x = x0;
-    te_variable vars[] = {{"x", &x}};
+    te_variable vars[GRAPH_VAR_MAX];
+    const int var_count = graph_vars(vars, &x, NULL, params);
     int err;
     
     char *expanded = expand_implicit_mul(func);
-    te_expr *expr = te_compile(expanded, vars, 1, &err);
+    te_expr *expr = te_compile(expanded, vars, var_count, &err);
     free(expanded);
     
     if (!expr || err) {
@@ -221,18 +685,31 @@ double numerical_derivative(const char *func, double x0)
     return (f_plus - f_minus) / (2.0 * h);
 }
 
-int draw_tangent(SDL_Renderer* renderer, const Viewport *v, const char* func, 
-                 int mouseX, int mouseY, int width, int height) 
+/* Window-space rect of the graph image inside the Clay layout. */
+static SDL_Rect graph_area(int width, int height)
 {
     // Account for UI padding (16px on each side from Clay layout)
     const int UI_PADDING = 16;
     const int UI_TOP_HEIGHT = 80;  // Approximate height of title and instructions
+
+    return (SDL_Rect) {
+        UI_PADDING,
+        UI_PADDING + UI_TOP_HEIGHT,
+        width - 2 * UI_PADDING,
+        height - 2 * UI_PADDING - UI_TOP_HEIGHT - 40   // 40 for bottom text
+    };
+}
+
+int draw_tangent(SDL_Renderer* renderer, const Viewport *v, const char* func, const double *params,
+                 int mouseX, int mouseY, int width, int height) 
+{
+    SDL_Rect area = graph_area(width, height);
     
     // Adjust mouse coordinates to graph coordinate space
-    int graph_mouse_x = mouseX - UI_PADDING;
-    int graph_mouse_y = mouseY - UI_PADDING - UI_TOP_HEIGHT;
-    int graph_width = width - 2 * UI_PADDING;
-    int graph_height = height - 2 * UI_PADDING - UI_TOP_HEIGHT - 40;  // 40 for bottom text
+    int graph_mouse_x = mouseX - area.x;
+    int graph_mouse_y = mouseY - area.y;
+    int graph_width = area.w;
+    int graph_height = area.h;
     
     // Check if mouse is within graph bounds
     if (graph_mouse_x < 0 || graph_mouse_x >= graph_width ||
@@ -246,11 +723,12 @@ int draw_tangent(SDL_Renderer* renderer, const Viewport *v, const char* func,
     
     // Evaluate function at x0
     double x = x0;
-    te_variable vars[] = {{"x", &x}};
+    te_variable vars[GRAPH_VAR_MAX];
+    const int var_count = graph_vars(vars, &x, NULL, params);
     int err;
     
     char *expanded = expand_implicit_mul(func);
-    te_expr *expr = te_compile(expanded, vars, 1, &err);
+    te_expr *expr = te_compile(expanded, vars, var_count, &err);
     free(expanded);
     
     if (!expr || err) {
@@ -265,7 +743,7 @@ int draw_tangent(SDL_Renderer* renderer, const Viewport *v, const char* func,
     }
     
     // Calculate derivative (slope)
-    double slope = numerical_derivative(func, x0);
+    double slope = numerical_derivative(func, params, x0);
     
     if (!isfinite(slope)) {
         return 0;
@@ -283,10 +761,10 @@ int draw_tangent(SDL_Renderer* renderer, const Viewport *v, const char* func,
     SDL_FPoint p2 = math_to_screen(v, x_right, y_right, graph_width, graph_height);
     
     // Adjust back to window coordinates
-    p1.x += UI_PADDING;
-    p1.y += UI_PADDING + UI_TOP_HEIGHT;
-    p2.x += UI_PADDING;
-    p2.y += UI_PADDING + UI_TOP_HEIGHT;
+    p1.x += area.x;
+    p1.y += area.y;
+    p2.x += area.x;
+    p2.y += area.y;
     
     // Draw tangent line in red
     SDL_SetRenderDrawColor(renderer, 255, 50, 50, 255);
@@ -294,8 +772,8 @@ int draw_tangent(SDL_Renderer* renderer, const Viewport *v, const char* func,
     
     // Draw point on curve
     SDL_FPoint point = math_to_screen(v, x0, y0, graph_width, graph_height);
-    point.x += UI_PADDING;
-    point.y += UI_PADDING + UI_TOP_HEIGHT;
+    point.x += area.x;
+    point.y += area.y;
     
     SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
     const float radius = 4.0f;
@@ -310,325 +788,2664 @@ int draw_tangent(SDL_Renderer* renderer, const Viewport *v, const char* func,
     return 0;
 }
 
-SDL_Texture* render_graph_to_texture(
-    SDL_Renderer *renderer,
-    const char *function,
-    const Viewport *viewport,
-    int width, 
-    int height,
-    TTF_Font *label_font,
-    Uint32 label_font_id)
+/* =========================
+   Worker Pool
+   ========================= */
+
+
+static void worker_pool_drain(WorkerPool *pool, WorkerTask task, void *userdata, int count, int worker)
 {
-    if (!function || !viewport || width <= 0 || height <= 0) {
-        return NULL;
+    for (;;) {
+        int index = SDL_AddAtomicInt(&pool->next, 1);
+        if (index >= count) break;
+        task(userdata, index, worker);
     }
+}
 
-    SDL_Surface *surface = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
-    if (!surface) {
-        SDL_Log("Failed to create surface: %s", SDL_GetError());
-        return NULL;
-    }
+static int SDLCALL worker_pool_thread(void *data)
+{
+    WorkerThreadArgs *args = data;
+    WorkerPool *pool = args->pool;
+    Uint32 seen = 0;
+
+    SDL_LockMutex(pool->lock);
+    for (;;) {
+        while (pool->batch == seen && !pool->quit) {
+            SDL_WaitCondition(pool->start, pool->lock);
+        }
+        if (pool->quit) break;
 
-    SDL_Renderer *soft_renderer = SDL_CreateSoftwareRenderer(surface);
-    if (!soft_renderer) {
-        SDL_Log("Failed to create software renderer: %s", SDL_GetError());
-        SDL_DestroySurface(surface);
-        return NULL;
+        seen = pool->batch;
+        WorkerTask task = pool->task;
+        void *userdata = pool->userdata;
+        int count = pool->count;
+        SDL_UnlockMutex(pool->lock);
+
+        worker_pool_drain(pool, task, userdata, count, args->id);
+
+        SDL_LockMutex(pool->lock);
+        if (--pool->active == 0) {
+            SDL_SignalCondition(pool->done);
+        }
     }
+    SDL_UnlockMutex(pool->lock);
 
-    SDL_SetRenderDrawColor(soft_renderer, 0, 0, 0, 255);
-    SDL_RenderClear(soft_renderer);
+    return 0;
+}
 
-    draw_grid(soft_renderer, viewport, width, height);
-    draw_axes(soft_renderer, viewport, width, height);
+bool worker_pool_init(WorkerPool *pool, int thread_count)
+{
+    SDL_zerop(pool);
+    pool->run_lock = SDL_CreateMutex();
+    pool->lock = SDL_CreateMutex();
+    pool->start = SDL_CreateCondition();
+    pool->done = SDL_CreateCondition();
+    pool->threads = SDL_calloc(SDL_max(thread_count, 1), sizeof(SDL_Thread *));
+    pool->args = SDL_calloc(SDL_max(thread_count, 1), sizeof(WorkerThreadArgs));
+    if (!pool->run_lock || !pool->lock || !pool->start || !pool->done || !pool->threads || !pool->args) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create worker pool: %s", SDL_GetError());
+        return false;
+    }
 
-    SDL_SetRenderDrawColor(soft_renderer, 0, 255, 0, 255);
-    drawGraph(soft_renderer, viewport, function, width, height);
+    for (int i = 0; i < thread_count; i++) {
+        pool->args[i] = (WorkerThreadArgs) { pool, i };
+        pool->threads[i] = SDL_CreateThread(worker_pool_thread, "graph_worker", &pool->args[i]);
+        if (!pool->threads[i]) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create worker thread: %s", SDL_GetError());
+            break;
+        }
+        pool->thread_count++;
+    }
 
-    SDL_RenderPresent(soft_renderer);
-    SDL_DestroyRenderer(soft_renderer);
+    return true;
+}
 
-    SDL_Color label_color = { 200, 200, 200, 255 };
+void worker_pool_destroy(WorkerPool *pool)
+{
+    if (pool->lock) {
+        SDL_LockMutex(pool->lock);
+        pool->quit = true;
+        SDL_BroadcastCondition(pool->start);
+        SDL_UnlockMutex(pool->lock);
+    }
 
-    double step = grid_step(viewport->xScale);
-    double halfW = (width / 2.0) / viewport->xScale;
-    double halfH = (height / 2.0) / viewport->yScale;
-    double xStart = floor((viewport->cx - halfW) / step) * step;
-    double xEnd   = ceil ((viewport->cx + halfW) / step) * step;
-    double yStart = floor((viewport->cy - halfH) / step) * step;
-    double yEnd   = ceil ((viewport->cy + halfH) / step) * step;
+    for (int i = 0; i < pool->thread_count; i++) {
+        SDL_WaitThread(pool->threads[i], NULL);
+    }
 
-    SDL_FPoint axis_origin = math_to_screen(viewport, 0.0, 0.0, width, height);
-    int axis_y = (int)axis_origin.y;
-    int axis_x = (int)axis_origin.x;
+    if (pool->done) SDL_DestroyCondition(pool->done);
+    if (pool->start) SDL_DestroyCondition(pool->start);
+    if (pool->lock) SDL_DestroyMutex(pool->lock);
+    if (pool->run_lock) SDL_DestroyMutex(pool->run_lock);
+    SDL_free(pool->args);
+    SDL_free(pool->threads);
+    SDL_zerop(pool);
+}
 
-    const int pad = 4;
+/* Runs task for every index in [0, count) and returns once all of them finished. */
+void worker_pool_run(WorkerPool *pool, int count, WorkerTask task, void *userdata)
+{
+    if (count <= 0) return;
 
-    for (double x = xStart; x <= xEnd; x += step) {
-        if (fabs(x) < 1e-9) continue;
+    if (!pool || pool->thread_count == 0) {
+        for (int i = 0; i < count; i++) task(userdata, i, 0);
+        return;
+    }
 
-        char buf[64];
-        snprintf(buf, sizeof(buf), "%.6g", x);
+    SDL_LockMutex(pool->run_lock);
 
-        SDL_FPoint p = math_to_screen(viewport, x, 0.0, width, height);
-        int px = (int)roundf(p.x);
+    SDL_LockMutex(pool->lock);
+    pool->task = task;
+    pool->userdata = userdata;
+    pool->count = count;
+    SDL_SetAtomicInt(&pool->next, 0);
+    pool->active = pool->thread_count;
+    pool->batch++;
+    SDL_BroadcastCondition(pool->start);
+    SDL_UnlockMutex(pool->lock);
 
-        int ty;
-        if (axis_y >= 0 && axis_y <= height) {
-            ty = axis_y + pad;
-            if (ty + 1 > height - pad) ty = height - pad - 12;
-        } else {
-            ty = (axis_y < 0) ? pad : (height - pad - 12);
-        }
+    worker_pool_drain(pool, task, userdata, count, pool->thread_count);
 
-        if (label_font) {
-            SDL_Surface *ts = TTF_RenderText_Blended(label_font, buf, strlen(buf), label_color);
-            if (ts) {
-                int tx = px - ts->w / 2;
-                SDL_Rect dst = { tx, ty, 0, 0 };
-                
-                if (dst.x < 0) dst.x = 0;
-                if (dst.x + ts->w > width) dst.x = width - ts->w;
-                if (dst.y < 0) dst.y = 0;
-                if (dst.y + ts->h > height) dst.y = height - ts->h;
-                
-                SDL_BlitSurface(ts, NULL, surface, &dst);
-                SDL_DestroySurface(ts);
-            }
-        }
+    SDL_LockMutex(pool->lock);
+    while (pool->active > 0) {
+        SDL_WaitCondition(pool->done, pool->lock);
     }
+    SDL_UnlockMutex(pool->lock);
 
-    for (double y = yStart; y <= yEnd; y += step) {
-        if (fabs(y) < 1e-9) continue;
+    SDL_UnlockMutex(pool->run_lock);
+}
 
-        char buf[64];
-        snprintf(buf, sizeof(buf), "%.6g", y);
+static inline int worker_pool_slots(const WorkerPool *pool)
+{
+    return pool ? pool->thread_count + 1 : 1;
+}
 
-        SDL_FPoint p = math_to_screen(viewport, 0.0, y, width, height);
-        int py = (int)roundf(p.y);
+/* =========================
+   2-D Field Rendering
+   ========================= */
 
-        int tx;
-        if (axis_x >= 0 && axis_x <= width) {
-            tx = axis_x + pad;
-            if (tx + 1 > width - pad) tx = width - pad - 30;
-        } else {
-            tx = (axis_x < 0) ? pad : (width - pad - 48);
-        }
 
-        if (label_font) {
-            SDL_Surface *ts = TTF_RenderText_Blended(label_font, buf, strlen(buf), label_color);
-            if (ts) {
-                SDL_Rect dst = { tx, py - ts->h / 2, 0, 0 };
-                
-                if (dst.x < 0) dst.x = 0;
-                if (dst.x + ts->w > width) dst.x = width - ts->w;
-                if (dst.y < 0) dst.y = 0;
-                if (dst.y + ts->h > height) dst.y = height - ts->h;
-                
-                SDL_BlitSurface(ts, NULL, surface, &dst);
-                SDL_DestroySurface(ts);
-            }
-        }
-    }
+typedef struct {
+    double x, y;
+    te_expr *expr;
+} FieldWorker;
 
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_DestroySurface(surface);
+typedef struct {
+    const char *expression;
+    te_precision precision;
+    const double *params;
+    FieldTile **misses;
+    FieldWorker *workers;
+    const RenderCancel *cancel;
+} FieldBatch;
+
+static inline Sint64 floor_div(Sint64 a, Sint64 b)
+{
+    Sint64 q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
 
-    return texture;
+static inline int field_tile_bucket(const FieldRenderer *fr, Sint64 tx, Sint64 ty)
+{
+    Uint64 h = (Uint64)tx * 0x9E3779B97F4A7C15ull ^ (Uint64)ty * 0xC2B2AE3D27D4EB4Full;
+    return (int)((h ^ (h >> 29)) & (Uint64)fr->bucket_mask);
 }
 
-void update_graph_texture(AppState *state, int width, int height)
+/* Drops every tile and its key, keeping the allocation. */
+static void field_renderer_invalidate(FieldRenderer *fr)
 {
-    if (state->graphState.graph_texture) {
-        SDL_DestroyTexture(state->graphState.graph_texture);
+    for (int i = 0; i < fr->capacity; i++) {
+        fr->tiles[i].keyed = false;
+        fr->tiles[i].valid = false;
     }
+    for (int i = 0; i <= fr->bucket_mask; i++) fr->buckets[i] = -1;
+}
 
-    TTF_Font *label_font = NULL;
-    if (state->rendererData.fonts) label_font = state->rendererData.fonts[FONT_ID];
+/* Makes room for at least twice visible tiles so every visible tile can be
+   claimed in one frame with a ring of panned-away tiles to spare. Growing
+   drops the cached tiles. */
+static bool field_renderer_reserve(FieldRenderer *fr, int visible)
+{
+    const int need = SDL_max(visible * 2, FIELD_CACHE_TILES);
+    if (fr->capacity >= need) return true;
+
+    int buckets = 1;
+    while (buckets < need * 2) buckets <<= 1;
+
+    FieldTile *tiles = SDL_calloc(need, sizeof(FieldTile));
+    int *heads = SDL_malloc(sizeof(int) * buckets);
+    if (!tiles || !heads) {
+        SDL_free(tiles);
+        SDL_free(heads);
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to allocate %d field tiles", need);
+        return false;
+    }
 
-    state->graphState.graph_texture = render_graph_to_texture(
-        state->rendererData.renderer,
-        state->graphState.function,
-        &state->graphState.viewport,
-        width, height,
-        label_font,
-        FONT_ID
-    );
+    SDL_free(fr->tiles);
+    SDL_free(fr->buckets);
+    fr->tiles = tiles;
+    fr->buckets = heads;
+    fr->capacity = need;
+    fr->bucket_mask = buckets - 1;
+
+    for (int i = 0; i < need; i++) {
+        tiles[i].hash_next = -1;
+        tiles[i].lru_prev = i - 1;
+        tiles[i].lru_next = i + 1 < need ? i + 1 : -1;
+    }
+    fr->lru_head = 0;
+    fr->lru_tail = need - 1;
+    field_renderer_invalidate(fr);
+    return true;
+}
 
-    state->graphState.needs_update = false;
+bool field_renderer_init(FieldRenderer *fr, WorkerPool *pool)
+{
+    SDL_zerop(fr);
+    fr->pool = pool;
+    return field_renderer_reserve(fr, 0);
 }
 
-void update_graph_movement(GraphState *gs, double dt)
+void field_renderer_destroy(FieldRenderer *fr)
 {
-    int n;
-    const bool *keys = SDL_GetKeyboardState(&n);
-    const double speed = 5.0;
+    SDL_free(fr->tiles);
+    SDL_free(fr->buckets);
+    fr->tiles = NULL;
+    fr->buckets = NULL;
+    fr->capacity = 0;
+}
 
-    gs->velocity.x = gs->velocity.y = 0;
-    if (keys[SDL_SCANCODE_A]) gs->velocity.x -= speed;
-    if (keys[SDL_SCANCODE_D]) gs->velocity.x += speed;
-    if (keys[SDL_SCANCODE_W]) gs->velocity.y += speed;
-    if (keys[SDL_SCANCODE_S]) gs->velocity.y -= speed;
+static void field_lru_touch(FieldRenderer *fr, int i)
+{
+    FieldTile *t = &fr->tiles[i];
+    if (fr->lru_head == i) return;
 
-    gs->viewport.cx += gs->velocity.x * dt;
-    gs->viewport.cy += gs->velocity.y * dt;
+    fr->tiles[t->lru_prev].lru_next = t->lru_next;
+    if (t->lru_next >= 0) fr->tiles[t->lru_next].lru_prev = t->lru_prev;
+    else fr->lru_tail = t->lru_prev;
 
-    if (gs->velocity.x != 0 || gs->velocity.y != 0) {
-        gs->needs_update = true;
-    }
+    t->lru_prev = -1;
+    t->lru_next = fr->lru_head;
+    fr->tiles[fr->lru_head].lru_prev = i;
+    fr->lru_head = i;
 }
 
-void update_graph_zoom(GraphState *gs, double dt)
+static void field_hash_remove(FieldRenderer *fr, int i)
 {
-    int n;
-    const bool *keys = SDL_GetKeyboardState(&n);
-    const double zoomSpeed = 1.5;
+    const FieldTile *t = &fr->tiles[i];
+    int *link = &fr->buckets[field_tile_bucket(fr, t->tx, t->ty)];
+    while (*link != i) link = &fr->tiles[*link].hash_next;
+    *link = t->hash_next;
+}
+
+/* Returns the cached tile or claims the least recently used one for it. Never
+   fails while fewer than half the tiles are claimed in the current frame. */
+static FieldTile *field_acquire_tile(FieldRenderer *fr, const Viewport *v, Sint64 tx, Sint64 ty, bool *hit)
+{
+    const int bucket = field_tile_bucket(fr, tx, ty);
+
+    for (int i = fr->buckets[bucket]; i >= 0; i = fr->tiles[i].hash_next) {
+        FieldTile *t = &fr->tiles[i];
+        if (t->tx == tx && t->ty == ty && t->xScale == v->xScale && t->yScale == v->yScale) {
+            field_lru_touch(fr, i);
+            t->last_used = fr->frame;
+            *hit = t->valid;    // a tile cancelled mid-frame keeps its slot and is filled again
+            return t;
+        }
+    }
+
+    const int victim = fr->lru_tail;
+    FieldTile *t = &fr->tiles[victim];
+    if (t->keyed && t->last_used == fr->frame) {
+        *hit = false;
+        return NULL;    // every tile is claimed by this frame; field_renderer_reserve prevents this
+    }
+    if (t->keyed) field_hash_remove(fr, victim);
+
+    t->keyed = true;
+    t->valid = false;
+    t->tx = tx;
+    t->ty = ty;
+    t->xScale = v->xScale;
+    t->yScale = v->yScale;
+    t->last_used = fr->frame;
+    t->hash_next = fr->buckets[bucket];
+    fr->buckets[bucket] = victim;
+    field_lru_touch(fr, victim);
+
+    *hit = false;
+    return t;
+}
+
+static void field_eval_tile(void *userdata, int index, int worker)
+{
+    FieldBatch *batch = userdata;
+    FieldWorker *w = &batch->workers[worker];
+    FieldTile *tile = batch->misses[index];
+
+    if (render_cancelled(batch->cancel)) return;
+
+    if (!w->expr) {
+        te_variable vars[GRAPH_VAR_MAX];
+        const int var_count = graph_vars(vars, &w->x, &w->y, batch->params);
+        int err;
+        w->expr = te_compile_precision(batch->expression, vars, var_count, batch->precision, &err);
+        if (!w->expr) return;
+    }
+
+    const double gx0 = (double)(tile->tx * FIELD_TILE_SIZE);
+    const double gy0 = (double)(tile->ty * FIELD_TILE_SIZE);
+    float *out = tile->values;
+
+    for (int j = 0; j < FIELD_TILE_SIZE; j++) {
+        w->y = -(gy0 + j + 0.5) / tile->yScale;
+        for (int i = 0; i < FIELD_TILE_SIZE; i++) {
+            w->x = (gx0 + i + 0.5) / tile->xScale;
+            *out++ = (float)te_eval(w->expr);
+        }
+    }
+
+    tile->valid = true;
+}
+
+static SDL_Color field_colormap(float t)
+{
+    static const Uint8 stops[5][3] = {
+        { 68,   1,  84 },
+        { 59,  82, 139 },
+        { 33, 145, 140 },
+        { 94, 201,  98 },
+        { 253, 231, 37 }
+    };
+
+    if (t <= 0.0f) t = 0.0f;
+    if (t >= 1.0f) t = 1.0f;
+
+    float f = t * 4.0f;
+    int k = (int)f;
+    if (k > 3) k = 3;
+    f -= (float)k;
+
+    return (SDL_Color) {
+        (Uint8)(stops[k][0] + (stops[k + 1][0] - stops[k][0]) * f),
+        (Uint8)(stops[k][1] + (stops[k + 1][1] - stops[k][1]) * f),
+        (Uint8)(stops[k][2] + (stops[k + 1][2] - stops[k][2]) * f),
+        255
+    };
+}
+
+static int compare_floats(const void *a, const void *b)
+{
+    float fa = *(const float *)a, fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+/* Color range from the 2nd..98th percentile so a single pole does not wash out the map. */
+static void field_value_range(float *const *rows, int width, int height, float *lo, float *hi)
+{
+    enum { MAX_SAMPLES = 4096 };
+    float samples[MAX_SAMPLES];
+    int n = 0;
+
+    long total = (long)width * height;
+    long stride = SDL_max(total / MAX_SAMPLES, 1);
+
+    for (long k = 0; k < total && n < MAX_SAMPLES; k += stride) {
+        float value = rows[k / width][k % width];
+        if (isfinite(value)) samples[n++] = value;
+    }
+
+    if (n == 0) {
+        *lo = 0.0f;
+        *hi = 1.0f;
+        return;
+    }
+
+    qsort(samples, n, sizeof(float), compare_floats);
+    *lo = samples[(n - 1) * 2 / 100];
+    *hi = samples[(n - 1) * 98 / 100];
+    if (!(*hi > *lo)) *hi = *lo + 1.0f;
+}
+
+static void draw_contours(SDL_Renderer *r, float *const *rows, int width, int height, float lo, float hi)
+{
+    const int gw = (width - 1) / FIELD_CONTOUR_STEP + 1;
+    const int gh = (height - 1) / FIELD_CONTOUR_STEP + 1;
+
+    SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(r, 255, 255, 255, 110);
+
+    for (int level = 0; level < FIELD_CONTOUR_LEVELS; level++) {
+        const float iso = lo + (hi - lo) * (level + 1) / (FIELD_CONTOUR_LEVELS + 1);
+
+        for (int gj = 0; gj + 1 < gh; gj++) {
+            const int y0 = gj * FIELD_CONTOUR_STEP;
+            const int y1 = SDL_min(y0 + FIELD_CONTOUR_STEP, height - 1);
+
+            for (int gi = 0; gi + 1 < gw; gi++) {
+                const int x0 = gi * FIELD_CONTOUR_STEP;
+                const int x1 = SDL_min(x0 + FIELD_CONTOUR_STEP, width - 1);
+
+                // a b
+                // d c
+                const float a = rows[y0][x0], b = rows[y0][x1];
+                const float c = rows[y1][x1], d = rows[y1][x0];
+                if (!isfinite(a) || !isfinite(b) || !isfinite(c) || !isfinite(d)) continue;
+
+                const int mask = (a > iso) | (b > iso) << 1 | (c > iso) << 2 | (d > iso) << 3;
+                if (mask == 0 || mask == 15) continue;
+
+                // crossings in edge order top, right, bottom, left
+                SDL_FPoint p[4];
+                int n = 0;
+                if ((a > iso) != (b > iso)) p[n++] = (SDL_FPoint) { x0 + (x1 - x0) * (iso - a) / (b - a), (float)y0 };
+                if ((b > iso) != (c > iso)) p[n++] = (SDL_FPoint) { (float)x1, y0 + (y1 - y0) * (iso - b) / (c - b) };
+                if ((c > iso) != (d > iso)) p[n++] = (SDL_FPoint) { x1 + (x0 - x1) * (iso - c) / (d - c), (float)y1 };
+                if ((d > iso) != (a > iso)) p[n++] = (SDL_FPoint) { (float)x0, y1 + (y0 - y1) * (iso - d) / (a - d) };
+
+                if (n == 2) {
+                    SDL_RenderLine(r, p[0].x, p[0].y, p[1].x, p[1].y);
+                } else if (n == 4) {
+                    // saddle: the center value decides which corners are connected
+                    const bool center_above = (a + b + c + d) * 0.25f > iso;
+                    if (center_above == (a > iso)) {
+                        SDL_RenderLine(r, p[0].x, p[0].y, p[1].x, p[1].y);
+                        SDL_RenderLine(r, p[2].x, p[2].y, p[3].x, p[3].y);
+                    } else {
+                        SDL_RenderLine(r, p[3].x, p[3].y, p[0].x, p[0].y);
+                        SDL_RenderLine(r, p[1].x, p[1].y, p[2].x, p[2].y);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static bool field_expression_compiles(const char *func, const double *params)
+{
+    double x = 0, y = 0;
+    te_variable vars[GRAPH_VAR_MAX];
+    const int var_count = graph_vars(vars, &x, &y, params);
+    int err;
+    char *expanded = expand_implicit_mul(func);
+    te_expr *probe = expanded ? te_compile(expanded, vars, var_count, &err) : NULL;
+    free(expanded);
+    te_free(probe);
+    return probe != NULL;
+}
+
+/* Fills surface with a colormapped heatmap of f(x, y) and returns its values as
+   rows of a freshly allocated copy, so contours can be traced afterwards while
+   the tile cache moves on. Release them with free_field_rows. func must
+   compile (field_expression_compiles). Returns NULL on error or cancellation. */
+static float **draw_field(FieldRenderer *fr, SDL_Surface *surface, const Viewport *v, const char *func,
+                          const double *params, te_precision precision, const RenderCancel *cancel,
+                          float *lo, float *hi, FieldStats *stats)
+{
+    const Uint64 start = SDL_GetPerformanceCounter();
+    const int width = surface->w;
+    const int height = surface->h;
+
+    char *expanded = expand_implicit_mul(func);
+    if (!expanded) return NULL;
+
+    if (strcmp(fr->function, func) != 0 || fr->precision != precision ||
+        SDL_memcmp(fr->params, params, sizeof(fr->params)) != 0) {
+        field_renderer_invalidate(fr);
+        SDL_strlcpy(fr->function, func, sizeof(fr->function));
+        fr->precision = precision;
+        SDL_memcpy(fr->params, params, sizeof(fr->params));
+    }
+    fr->frame++;
+
+    const Sint64 ox = (Sint64)floor(v->cx * v->xScale - width / 2.0);
+    const Sint64 oy = (Sint64)floor(-v->cy * v->yScale - height / 2.0);
+    const Sint64 tx0 = floor_div(ox, FIELD_TILE_SIZE);
+    const Sint64 ty0 = floor_div(oy, FIELD_TILE_SIZE);
+    const int ntx = (int)(floor_div(ox + width - 1, FIELD_TILE_SIZE) - tx0 + 1);
+    const int nty = (int)(floor_div(oy + height - 1, FIELD_TILE_SIZE) - ty0 + 1);
+
+    // Grows on the first frame after a resize so no visible tile is left without a slot.
+    if (!field_renderer_reserve(fr, ntx * nty)) {
+        free(expanded);
+        return NULL;
+    }
+
+    FieldTile **visible = calloc((size_t)ntx * nty, sizeof(FieldTile *));
+    FieldTile **misses = calloc((size_t)ntx * nty, sizeof(FieldTile *));
+    FieldWorker *workers = calloc(worker_pool_slots(fr->pool), sizeof(FieldWorker));
+    float **rows = calloc(height, sizeof(float *));
+    float *scratch = malloc(sizeof(float) * width * height);
+    if (!visible || !misses || !workers || !rows || !scratch) {
+        free(visible); free(misses); free(workers); free(rows); free(scratch); free(expanded);
+        return NULL;
+    }
+
+    int miss_count = 0;
+    for (int j = 0; j < nty; j++) {
+        for (int i = 0; i < ntx; i++) {
+            bool hit;
+            FieldTile *tile = field_acquire_tile(fr, v, tx0 + i, ty0 + j, &hit);
+            visible[j * ntx + i] = tile;
+            if (tile && !hit) misses[miss_count++] = tile;
+        }
+    }
+
+    const Uint64 eval_start = SDL_GetPerformanceCounter();
+    FieldBatch batch = { expanded, precision, params, misses, workers, cancel };
+    worker_pool_run(fr->pool, miss_count, field_eval_tile, &batch);
+    const Uint64 eval_end = SDL_GetPerformanceCounter();
+
+    for (int i = 0; i < worker_pool_slots(fr->pool); i++) te_free(workers[i].expr);
+    free(workers);
+    free(misses);
+    free(expanded);
+
+    // Gather the visible window into one contiguous grid; unfinished tiles read as NaN.
+    for (int j = 0; j < height; j++) {
+        const Sint64 gy = oy + j;
+        const Sint64 ty = floor_div(gy, FIELD_TILE_SIZE);
+        const int ly = (int)(gy - ty * FIELD_TILE_SIZE);
+        float *row = scratch + (size_t)j * width;
+        rows[j] = row;
+
+        for (int i = 0; i < width; i++) {
+            const Sint64 gx = ox + i;
+            const Sint64 tx = floor_div(gx, FIELD_TILE_SIZE);
+            const FieldTile *tile = visible[(ty - ty0) * ntx + (tx - tx0)];
+            row[i] = (tile && tile->valid) ? tile->values[ly * FIELD_TILE_SIZE + (gx - tx * FIELD_TILE_SIZE)] : NAN;
+        }
+    }
+    free(visible);
+
+    if (render_cancelled(cancel)) {
+        free(scratch);
+        free(rows);
+        return NULL;
+    }
+
+    field_value_range(rows, width, height, lo, hi);
+    const float inv = 1.0f / (*hi - *lo);
+
+    for (int j = 0; j < height; j++) {
+        Uint8 *pixel = (Uint8 *)surface->pixels + (size_t)j * surface->pitch;
+        for (int i = 0; i < width; i++, pixel += 4) {
+            const float value = rows[j][i];
+            SDL_Color c = isfinite(value) ? field_colormap((value - *lo) * inv) : (SDL_Color) { 0, 0, 0, 255 };
+            pixel[0] = c.r;
+            pixel[1] = c.g;
+            pixel[2] = c.b;
+            pixel[3] = c.a;
+        }
+    }
+
+    const double freq = (double)SDL_GetPerformanceFrequency();
+    *stats = (FieldStats) {
+        .tiles_visible = ntx * nty,
+        .tiles_evaluated = miss_count,
+        .evaluations = (Uint64)miss_count * FIELD_TILE_SIZE * FIELD_TILE_SIZE,
+        .eval_ms = (eval_end - eval_start) * 1000.0 / freq,
+        .total_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / freq
+    };
+    SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION,
+                 "field: %d/%d tiles evaluated, %llu evals in %.2f ms, frame %.2f ms",
+                 stats->tiles_evaluated, stats->tiles_visible,
+                 (unsigned long long)stats->evaluations, stats->eval_ms, stats->total_ms);
+
+    return rows;
+}
+
+static void free_field_rows(float **rows)
+{
+    if (rows) {
+        free(rows[0]);
+        free(rows);
+    }
+}
+
+
+/* =========================
+   Definite Integrals
+   ========================= */
+
+typedef struct {
+    double x;
+    te_expr *expr;
+} IntegralWorker;
+
+typedef struct {
+    double a, b;
+    Sint64 panel;           // lattice index, or INT64_MIN for a partial end panel
+    double value;
+    double error;
+    int evaluations;
+} IntegralTask;
+
+typedef struct {
+    const char *expression;
+    const double *params;
+    IntegralTask *tasks;
+    IntegralWorker *workers;
+    const RenderCancel *cancel;
+} IntegralBatch;
+
+/* 7-point Gauss / 15-point Kronrod pair, abscissae on [0, 1] (QUADPACK qk15). */
+static const double GK15_XGK[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000
+};
+static const double GK15_WGK[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+};
+static const double GK15_WG[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+};
+
+static double gk15(IntegralWorker *w, double a, double b, double *error)
+{
+    const double center = 0.5 * (a + b);
+    const double half = 0.5 * (b - a);
+
+    w->x = center;
+    const double fc = te_eval(w->expr);
+    double gauss = fc * GK15_WG[3];
+    double kronrod = fc * GK15_WGK[7];
+
+    for (int j = 0; j < 7; j++) {
+        const double dx = half * GK15_XGK[j];
+        w->x = center - dx;
+        const double f1 = te_eval(w->expr);
+        w->x = center + dx;
+        const double f2 = te_eval(w->expr);
+
+        kronrod += GK15_WGK[j] * (f1 + f2);
+        if (j & 1) gauss += GK15_WG[j / 2] * (f1 + f2);
+    }
+
+    *error = fabs((kronrod - gauss) * half);
+    return kronrod * half;
+}
+
+static double integrate_adaptive(IntegralWorker *w, double a, double b, double tol, int depth,
+                                 double *error, int *evaluations)
+{
+    double err;
+    const double value = gk15(w, a, b, &err);
+    *evaluations += 15;
+
+    if (err <= SDL_max(tol, INTEGRAL_REL_TOL * fabs(value)) || depth >= INTEGRAL_MAX_DEPTH || !isfinite(value)) {
+        *error += err;
+        return value;
+    }
+
+    const double mid = 0.5 * (a + b);
+    return integrate_adaptive(w, a, mid, tol / 2, depth + 1, error, evaluations) +
+           integrate_adaptive(w, mid, b, tol / 2, depth + 1, error, evaluations);
+}
+
+static void integral_eval_task(void *userdata, int index, int worker)
+{
+    IntegralBatch *batch = userdata;
+    IntegralWorker *w = &batch->workers[worker];
+    IntegralTask *task = &batch->tasks[index];
+
+    task->value = NAN;
+    if (render_cancelled(batch->cancel)) return;
+
+    if (!w->expr) {
+        te_variable vars[GRAPH_VAR_MAX];
+        const int var_count = graph_vars(vars, &w->x, NULL, batch->params);
+        int err;
+        w->expr = te_compile(batch->expression, vars, var_count, &err);
+        if (!w->expr) return;
+    }
+
+    task->error = 0;
+    task->evaluations = 0;
+    task->value = integrate_adaptive(w, task->a, task->b, INTEGRAL_TOL_PER_UNIT * (task->b - task->a), 0,
+                                     &task->error, &task->evaluations);
+}
+
+bool integral_cache_init(IntegralCache *ic, WorkerPool *pool)
+{
+    SDL_zerop(ic);
+    ic->pool = pool;
+    ic->panels = SDL_calloc(INTEGRAL_CACHE_SIZE, sizeof(IntegralPanel));
+    if (!ic->panels) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to allocate integral cache");
+        return false;
+    }
+    return true;
+}
+
+void integral_cache_destroy(IntegralCache *ic)
+{
+    SDL_free(ic->panels);
+    ic->panels = NULL;
+}
+
+static void integral_cache_clear(IntegralCache *ic)
+{
+    SDL_memset(ic->panels, 0, sizeof(IntegralPanel) * INTEGRAL_CACHE_SIZE);
+    ic->count = 0;
+}
+
+static IntegralPanel *integral_cache_slot(IntegralCache *ic, Sint64 panel)
+{
+    Uint64 h = (Uint64)panel * 0x9E3779B97F4A7C15ull;
+    for (int probe = 0; probe < INTEGRAL_CACHE_SIZE; probe++) {
+        IntegralPanel *slot = &ic->panels[(h + probe) & (INTEGRAL_CACHE_SIZE - 1)];
+        if (!slot->used || slot->panel == panel) return slot;
+    }
+    return NULL;
+}
+
+/* Signed integral of func over [a, b], reusing every full lattice panel already computed. */
+static bool integrate_interval(IntegralCache *ic, const char *func, const double *params, double a, double b,
+                               double panel_width, const RenderCancel *cancel, IntegralStats *stats)
+{
+    const Uint64 start = SDL_GetPerformanceCounter();
+    *stats = (IntegralStats) { 0 };
+
+    const double sign = a <= b ? 1.0 : -1.0;
+    const double lo = SDL_min(a, b), hi = SDL_max(a, b);
+
+    // Very long intervals fall back to a coarser lattice rather than overflowing the cache.
+    while ((hi - lo) / panel_width > INTEGRAL_CACHE_SIZE / 2) {
+        panel_width *= 2;
+    }
+
+    if (strcmp(ic->function, func) != 0 || ic->panel_width != panel_width ||
+        SDL_memcmp(ic->params, params, sizeof(ic->params)) != 0) {
+        integral_cache_clear(ic);
+        SDL_strlcpy(ic->function, func, sizeof(ic->function));
+        ic->panel_width = panel_width;
+        SDL_memcpy(ic->params, params, sizeof(ic->params));
+    }
+
+    const Sint64 p0 = (Sint64)ceil(lo / panel_width);
+    const Sint64 p1 = (Sint64)floor(hi / panel_width);
+    const Sint64 full = p1 > p0 ? p1 - p0 : 0;
+
+    IntegralTask *tasks = calloc((size_t)full + 2, sizeof(IntegralTask));
+    IntegralWorker *workers = calloc(worker_pool_slots(ic->pool), sizeof(IntegralWorker));
+    if (!tasks || !workers) {
+        free(tasks);
+        free(workers);
+        return false;
+    }
+
+    double value = 0, error = 0;
+    int task_count = 0;
+
+    if (p0 > p1) {
+        tasks[task_count++] = (IntegralTask) { lo, hi, INT64_MIN };
+    } else {
+        if (p0 * panel_width > lo) tasks[task_count++] = (IntegralTask) { lo, p0 * panel_width, INT64_MIN };
+        if (hi > p1 * panel_width) tasks[task_count++] = (IntegralTask) { p1 * panel_width, hi, INT64_MIN };
+
+        for (Sint64 k = p0; k < p1; k++) {
+            IntegralPanel *cached = integral_cache_slot(ic, k);
+            if (cached && cached->used) {
+                value += cached->value;
+                error += cached->error;
+            } else {
+                tasks[task_count++] = (IntegralTask) { k * panel_width, (k + 1) * panel_width, k };
+            }
+        }
+    }
+
+    char *expanded = expand_implicit_mul(func);
+    IntegralBatch batch = { expanded, params, tasks, workers, cancel };
+    worker_pool_run(ic->pool, task_count, integral_eval_task, &batch);
+
+    for (int i = 0; i < worker_pool_slots(ic->pool); i++) te_free(workers[i].expr);
+    free(workers);
+    free(expanded);
+
+    if (render_cancelled(cancel)) {
+        free(tasks);
+        return false;
+    }
+
+    if (ic->count + task_count > INTEGRAL_CACHE_SIZE * 3 / 4) {
+        integral_cache_clear(ic);
+    }
+
+    for (int i = 0; i < task_count; i++) {
+        const IntegralTask *task = &tasks[i];
+        value += task->value;
+        error += task->error;
+        stats->evaluations += task->evaluations;
+
+        if (task->panel != INT64_MIN && isfinite(task->value)) {
+            IntegralPanel *slot = integral_cache_slot(ic, task->panel);
+            if (slot && !slot->used) {
+                *slot = (IntegralPanel) { true, task->panel, task->value, task->error, task->evaluations };
+                ic->count++;
+            }
+        }
+    }
+    free(tasks);
+
+    stats->value = sign * value;
+    stats->error = error;
+    stats->panels = (int)full + (p0 > p1 ? 1 : (p0 * panel_width > lo) + (hi > p1 * panel_width));
+    stats->panels_computed = task_count;
+    stats->ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    stats->valid = true;
+    return true;
+}
+
+/* Fills the area between the x axis and the curve over [a, b] with a single geometry call. */
+static void draw_integral_area(SDL_Renderer *r, const Viewport *v, ExprCache *exprs, const char *func,
+                               const double *params, double a, double b, int width, int height,
+                               te_precision precision)
+{
+    const double lo = SDL_min(a, b), hi = SDL_max(a, b);
+    const int c0 = SDL_max((int)ceil(math_to_screen(v, lo, 0, width, height).x), 0);
+    const int c1 = SDL_min((int)floor(math_to_screen(v, hi, 0, width, height).x), width - 1);
+    const int columns = c1 - c0 + 1;
+    if (columns < 2) return;
+
+    te_expr *expr = expr_cache_get(exprs, func, precision);
+    if (!expr) return;
+    SDL_memcpy(exprs->params, params, sizeof(exprs->params));
+
+    SDL_Vertex *vertices = malloc(sizeof(SDL_Vertex) * columns * 2);
+    int *indices = malloc(sizeof(int) * (columns - 1) * 6);
+    if (!vertices || !indices) {
+        free(vertices);
+        free(indices);
+        return;
+    }
+
+    const SDL_FColor fill = { 0.2f, 0.6f, 1.0f, 0.35f };
+    const float axis_y = math_to_screen(v, 0, 0, width, height).y;
+    int vertex_count = 0, index_count = 0;
+    int prev = -1;
+
+    for (int c = c0; c <= c1; c++) {
+        const double x = exprs->x = v->cx + (c - width / 2.0) / v->xScale;
+        const double y = te_eval(expr);
+
+        if (!isfinite(y)) {
+            prev = -1;
+            continue;
+        }
+
+        const float py = SDL_clamp(math_to_screen(v, x, y, width, height).y, -1.0f, (float)height + 1.0f);
+        vertices[vertex_count++] = (SDL_Vertex) { { (float)c, axis_y }, fill, { 0, 0 } };
+        vertices[vertex_count++] = (SDL_Vertex) { { (float)c, py }, fill, { 0, 0 } };
+
+        if (prev >= 0) {
+            indices[index_count++] = prev;
+            indices[index_count++] = prev + 1;
+            indices[index_count++] = vertex_count - 2;
+            indices[index_count++] = prev + 1;
+            indices[index_count++] = vertex_count - 1;
+            indices[index_count++] = vertex_count - 2;
+        }
+        prev = vertex_count - 2;
+    }
+
+    SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_BLEND);
+    SDL_RenderGeometry(r, NULL, vertices, vertex_count, indices, index_count);
+
+    free(vertices);
+    free(indices);
+}
+
+/* CPU half of the graph pipeline: safe to call off the main thread as long as
+   label_font and caches are not shared. Returns NULL on error or when cancelled. */
+SDL_Surface* render_graph_to_surface(
+    const GraphJob *job,
+    TTF_Font *label_font,
+    GraphCaches *caches,
+    const RenderCancel *cancel,
+    FrameStats *stats)
+{
+    if (!job || job->width <= 0 || job->height <= 0) {
+        return NULL;
+    }
+
+    const char *function = job->function;
+    const Viewport *viewport = &job->viewport;
+    const int width = job->width;
+    const int height = job->height;
+
+    FrameStats frame_stats = { 0 };
+    if (!stats) stats = &frame_stats;
+    *stats = (FrameStats) { 0 };
+
+    SDL_Surface *surface = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        SDL_Log("Failed to create surface: %s", SDL_GetError());
+        return NULL;
+    }
+
+    SDL_Renderer *soft_renderer = SDL_CreateSoftwareRenderer(surface);
+    if (!soft_renderer) {
+        SDL_Log("Failed to create software renderer: %s", SDL_GetError());
+        SDL_DestroySurface(surface);
+        return NULL;
+    }
+
+    if (job->mode == GRAPH_MODE_FIELD) {
+        float lo, hi;
+        float **rows = NULL;
+        stats->expression_error = !field_expression_compiles(function, job->params);
+        if (stats->expression_error) {
+            SDL_Log("Expression error");
+        } else {
+            rows = draw_field(&caches->field, surface, viewport, function, job->params, job->precision,
+                              cancel, &lo, &hi, &stats->field);
+        }
+        if (!rows) {
+            SDL_SetRenderDrawColor(soft_renderer, 0, 0, 0, 255);
+            SDL_RenderClear(soft_renderer);
+        }
+
+        draw_axes(soft_renderer, viewport, width, height);
+
+        if (rows) {
+            draw_contours(soft_renderer, rows, width, height, lo, hi);
+            free_field_rows(rows);
+        }
+    } else {
+        SDL_SetRenderDrawColor(soft_renderer, 0, 0, 0, 255);
+        SDL_RenderClear(soft_renderer);
+
+        draw_grid(soft_renderer, viewport, width, height);
+        draw_axes(soft_renderer, viewport, width, height);
+
+        const te_precision precision = checked_precision(&caches->exprs, job);
+        if (job->integral) {
+            draw_integral_area(soft_renderer, viewport, &caches->exprs, function, job->params, job->ia, job->ib,
+                               width, height, precision);
+            integrate_interval(&caches->integral, function, job->params, job->ia, job->ib,
+                               grid_step(viewport->xScale) / INTEGRAL_PANELS_PER_GRID, cancel, &stats->integral);
+        }
+
+        SDL_SetRenderDrawColor(soft_renderer, 0, 255, 0, 255);
+        stats->expression_error = drawGraph(soft_renderer, viewport, &caches->exprs, &caches->subtrees, function,
+                                            job->params, width, height, precision, cancel) == GRAPH_EXPRESSION_ERROR;
+    }
+
+    SDL_RenderPresent(soft_renderer);
+    SDL_DestroyRenderer(soft_renderer);
+
+    if (render_cancelled(cancel)) {
+        SDL_DestroySurface(surface);
+        return NULL;
+    }
+
+    SDL_Color label_color = { 200, 200, 200, 255 };
+
+    double step = grid_step(viewport->xScale);
+    double halfW = (width / 2.0) / viewport->xScale;
+    double halfH = (height / 2.0) / viewport->yScale;
+    double xStart = floor((viewport->cx - halfW) / step) * step;
+    double xEnd   = ceil ((viewport->cx + halfW) / step) * step;
+    double yStart = floor((viewport->cy - halfH) / step) * step;
+    double yEnd   = ceil ((viewport->cy + halfH) / step) * step;
+
+    SDL_FPoint axis_origin = math_to_screen(viewport, 0.0, 0.0, width, height);
+    int axis_y = (int)axis_origin.y;
+    int axis_x = (int)axis_origin.x;
+
+    const int pad = 4;
+
+    for (double x = xStart; x <= xEnd; x += step) {
+        if (fabs(x) < 1e-9) continue;
+
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.6g", x);
+
+        SDL_FPoint p = math_to_screen(viewport, x, 0.0, width, height);
+        int px = (int)roundf(p.x);
+
+        int ty;
+        if (axis_y >= 0 && axis_y <= height) {
+            ty = axis_y + pad;
+            if (ty + 1 > height - pad) ty = height - pad - 12;
+        } else {
+            ty = (axis_y < 0) ? pad : (height - pad - 12);
+        }
+
+        if (label_font) {
+            SDL_Surface *ts = TTF_RenderText_Blended(label_font, buf, strlen(buf), label_color);
+            if (ts) {
+                int tx = px - ts->w / 2;
+                SDL_Rect dst = { tx, ty, 0, 0 };
+                
+                if (dst.x < 0) dst.x = 0;
+                if (dst.x + ts->w > width) dst.x = width - ts->w;
+                if (dst.y < 0) dst.y = 0;
+                if (dst.y + ts->h > height) dst.y = height - ts->h;
+                
+                SDL_BlitSurface(ts, NULL, surface, &dst);
+                SDL_DestroySurface(ts);
+            }
+        }
+    }
+
+    for (double y = yStart; y <= yEnd; y += step) {
+        if (fabs(y) < 1e-9) continue;
+
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.6g", y);
+
+        SDL_FPoint p = math_to_screen(viewport, 0.0, y, width, height);
+        int py = (int)roundf(p.y);
+
+        int tx;
+        if (axis_x >= 0 && axis_x <= width) {
+            tx = axis_x + pad;
+            if (tx + 1 > width - pad) tx = width - pad - 30;
+        } else {
+            tx = (axis_x < 0) ? pad : (width - pad - 48);
+        }
+
+        if (label_font) {
+            SDL_Surface *ts = TTF_RenderText_Blended(label_font, buf, strlen(buf), label_color);
+            if (ts) {
+                SDL_Rect dst = { tx, py - ts->h / 2, 0, 0 };
+                
+                if (dst.x < 0) dst.x = 0;
+                if (dst.x + ts->w > width) dst.x = width - ts->w;
+                if (dst.y < 0) dst.y = 0;
+                if (dst.y + ts->h > height) dst.y = height - ts->h;
+                
+                SDL_BlitSurface(ts, NULL, surface, &dst);
+                SDL_DestroySurface(ts);
+            }
+        }
+    }
+
+    return surface;
+}
+
+SDL_Texture* render_graph_to_texture(
+    SDL_Renderer *renderer,
+    const GraphJob *job,
+    TTF_Font *label_font,
+    GraphCaches *caches)
+{
+    SDL_Surface *surface = render_graph_to_surface(job, label_font, caches, NULL, NULL);
+    if (!surface) {
+        return NULL;
+    }
+
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_DestroySurface(surface);
+
+    return texture;
+}
+
+/* =========================
+   Background Graph Renderer
+   ========================= */
+
+static int SDLCALL graph_render_thread(void *data)
+{
+    GraphRenderer *gr = data;
+
+    SDL_LockMutex(gr->lock);
+    for (;;) {
+        while (!gr->has_pending && !gr->quit) {
+            SDL_WaitCondition(gr->wake, gr->lock);
+        }
+        if (gr->quit) break;
+
+        // Only the newest job survives; anything submitted while we were busy was overwritten.
+        GraphJob job = gr->pending;
+        gr->has_pending = false;
+        gr->running = job;
+        gr->busy = true;
+        RenderCancel cancel = { &gr->generation, SDL_GetAtomicInt(&gr->generation) };
+        SDL_UnlockMutex(gr->lock);
+
+        FrameStats stats;
+        SDL_Surface *surface = render_graph_to_surface(&job, gr->label_font, &gr->caches, &cancel, &stats);
+
+        SDL_LockMutex(gr->lock);
+        gr->busy = false;
+        if (surface) {
+            if (gr->completed) SDL_DestroySurface(gr->completed);
+            gr->completed = surface;
+            gr->stats = stats;
+        }
+    }
+    SDL_UnlockMutex(gr->lock);
+
+    return 0;
+}
+
+bool graph_caches_init(GraphCaches *caches, WorkerPool *pool)
+{
+    return field_renderer_init(&caches->field, pool) && integral_cache_init(&caches->integral, pool);
+}
+
+void graph_caches_destroy(GraphCaches *caches)
+{
+    field_renderer_destroy(&caches->field);
+    integral_cache_destroy(&caches->integral);
+    expr_cache_destroy(&caches->exprs);
+    subtree_cache_clear(&caches->subtrees);
+}
+
+bool graph_renderer_start(GraphRenderer *gr, const char *font_path, float font_size)
+{
+    gr->label_font = TTF_OpenFont(font_path, font_size);
+    if (!gr->label_font) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to load label font: %s", SDL_GetError());
+    }
+
+    gr->lock = SDL_CreateMutex();
+    gr->wake = SDL_CreateCondition();
+    if (!gr->lock || !gr->wake) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create render thread sync: %s", SDL_GetError());
+        return false;
+    }
+
+    int cores = SDL_GetNumLogicalCPUCores();
+    if (!worker_pool_init(&gr->pool, SDL_max(cores - 1, 0)) || !graph_caches_init(&gr->caches, &gr->pool)) {
+        return false;
+    }
+
+    gr->thread = SDL_CreateThread(graph_render_thread, "graph_render", gr);
+    if (!gr->thread) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create render thread: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+void graph_renderer_stop(GraphRenderer *gr)
+{
+    if (gr->thread) {
+        SDL_LockMutex(gr->lock);
+        gr->quit = true;
+        SDL_AddAtomicInt(&gr->generation, 1);
+        SDL_SignalCondition(gr->wake);
+        SDL_UnlockMutex(gr->lock);
+        SDL_WaitThread(gr->thread, NULL);
+        gr->thread = NULL;
+    }
+
+    worker_pool_destroy(&gr->pool);
+    graph_caches_destroy(&gr->caches);
+
+    if (gr->completed) SDL_DestroySurface(gr->completed);
+    if (gr->wake) SDL_DestroyCondition(gr->wake);
+    if (gr->lock) SDL_DestroyMutex(gr->lock);
+    if (gr->label_font) TTF_CloseFont(gr->label_font);
+
+    gr->completed = NULL;
+    gr->wake = NULL;
+    gr->lock = NULL;
+    gr->label_font = NULL;
+}
+
+/* Replaces any job that has not started yet. The one in flight is only cancelled
+   once its picture is wrong rather than late, i.e. the function or mode changed.
+   Cancelling it for a newer viewport or parameter would starve the display while
+   input is continuous (panning, slider drags, animation) and frames are slower
+   than the refresh rate. */
+void graph_renderer_submit(GraphRenderer *gr, const GraphJob *job)
+{
+    SDL_LockMutex(gr->lock);
+    gr->pending = *job;
+    gr->has_pending = true;
+    if (gr->busy && (gr->running.mode != job->mode || strcmp(gr->running.function, job->function) != 0)) {
+        SDL_AddAtomicInt(&gr->generation, 1);
+    }
+    SDL_SignalCondition(gr->wake);
+    SDL_UnlockMutex(gr->lock);
+}
+
+/* True once every submitted job has finished or been dropped. */
+bool graph_renderer_idle(GraphRenderer *gr)
+{
+    SDL_LockMutex(gr->lock);
+    bool idle = !gr->busy && !gr->has_pending;
+    SDL_UnlockMutex(gr->lock);
+    return idle;
+}
+
+/* Hands the latest completed frame to the caller, or NULL if nothing new. */
+SDL_Surface *graph_renderer_take(GraphRenderer *gr, FrameStats *stats)
+{
+    SDL_LockMutex(gr->lock);
+    SDL_Surface *surface = gr->completed;
+    gr->completed = NULL;
+    if (surface && stats) *stats = gr->stats;
+    SDL_UnlockMutex(gr->lock);
+    return surface;
+}
+
+/* Renders a job on the calling thread with the renderer's font and caches.
+   Only valid while no job is queued, e.g. for headless replay. */
+SDL_Surface *graph_renderer_render_now(GraphRenderer *gr, const GraphJob *job, FrameStats *stats)
+{
+    return render_graph_to_surface(job, gr->label_font, &gr->caches, NULL, stats);
+}
+
+/* Fastest builtin tier whose relative error stays under half a pixel for the
+   largest |y| on screen. Field values end up in floats and a colormap, so the
+   fast tier is always enough there. For curves this is only a first guess: the
+   bound is relative to the result, which terms can cancel far below their own
+   size (cosh(x)-exp(x)/2), so the render thread checks it against exact with
+   checked_precision before drawing, which the job is marked for here. */
+static te_precision plot_precision(const GraphState *gs, GraphJob *job)
+{
+    job->check_precision = gs->precision_auto && job->mode == GRAPH_MODE_CURVE;
+    if (!gs->precision_auto) return gs->precision;
+    if (job->mode == GRAPH_MODE_FIELD) return TE_PRECISION_FAST;
+
+    const double reach = fabs(job->viewport.cy) * job->viewport.yScale + job->height / 2.0;   // in pixels
+    if (reach * 1e-7 < 0.5) return TE_PRECISION_FAST;
+    if (reach * 1e-12 < 0.5) return TE_PRECISION_HIGH;
+    return TE_PRECISION_EXACT;
+}
+
+static GraphJob make_graph_job(const GraphState *gs, int width, int height)
+{
+    GraphJob job = {
+        .mode = gs->mode,
+        .viewport = gs->viewport,
+        .width = width,
+        .height = height,
+        .integral = gs->show_integral,
+        .ia = gs->integral_a,
+        .ib = gs->integral_b
+    };
+    SDL_strlcpy(job.function, gs->function, sizeof(job.function));
+    SDL_memcpy(job.params, gs->params, sizeof(job.params));
+    job.precision = plot_precision(gs, &job);
+    return job;
+}
+
+void request_graph_render(AppState *state, int width, int height)
+{
+    GraphJob job = make_graph_job(&state->graphState, width, height);
+    graph_renderer_submit(&state->graphState.renderer, &job);
+    state->graphState.needs_update = false;
+}
+
+/* Uploads a finished frame, the only part of graph rendering left on the main thread. */
+void update_graph_texture(AppState *state)
+{
+    SDL_Surface *surface = graph_renderer_take(&state->graphState.renderer, &state->graphState.stats);
+    if (!surface) {
+        return;
+    }
+
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(state->rendererData.renderer, surface);
+    SDL_DestroySurface(surface);
+    if (!texture) {
+        SDL_Log("Failed to upload graph texture: %s", SDL_GetError());
+        return;
+    }
+
+    if (state->graphState.graph_texture) {
+        SDL_DestroyTexture(state->graphState.graph_texture);
+    }
+    state->graphState.graph_texture = texture;
+}
+
+void update_graph_movement(GraphState *gs, const bool *keys, double dt)
+{
+    const double speed = 5.0;
+
+    gs->velocity.x = gs->velocity.y = 0;
+    if (keys[SDL_SCANCODE_A]) gs->velocity.x -= speed;
+    if (keys[SDL_SCANCODE_D]) gs->velocity.x += speed;
+    if (keys[SDL_SCANCODE_W]) gs->velocity.y += speed;
+    if (keys[SDL_SCANCODE_S]) gs->velocity.y -= speed;
+
+    gs->viewport.cx += gs->velocity.x * dt;
+    gs->viewport.cy += gs->velocity.y * dt;
+
+    if (gs->velocity.x != 0 || gs->velocity.y != 0) {
+        gs->needs_update = true;
+    }
+}
+
+/* t runs at one unit per second and wraps at the end of its slider. */
+void update_graph_animation(GraphState *gs, double dt)
+{
+    if (!gs->animating || gs->dragging_param == 0) return;
+
+    const double span = GRAPH_PARAM_MAX[0] - GRAPH_PARAM_MIN[0];
+    gs->params[0] = GRAPH_PARAM_MIN[0] + fmod(gs->params[0] - GRAPH_PARAM_MIN[0] + dt, span);
+    gs->needs_update = true;
+}
+
+void update_graph_zoom(GraphState *gs, const bool *keys, double dt)
+{
+    const double zoomSpeed = 1.5;
 
     bool zoomed = false;
 
-    if (keys[SDL_SCANCODE_Z]) {
-        double factor = exp(zoomSpeed * dt);
-        gs->viewport.xScale *= factor;
-        gs->viewport.yScale *= factor;
-        zoomed = true;
+    if (keys[SDL_SCANCODE_Z]) {
+        double factor = exp(zoomSpeed * dt);
+        gs->viewport.xScale *= factor;
+        gs->viewport.yScale *= factor;
+        zoomed = true;
+    }
+    if (keys[SDL_SCANCODE_X]) {
+        double factor = exp(-zoomSpeed * dt);
+        gs->viewport.xScale *= factor;
+        gs->viewport.yScale *= factor;
+        zoomed = true;
+    }
+
+    if (gs->viewport.xScale < 10)  gs->viewport.xScale = gs->viewport.yScale = 10;
+    if (gs->viewport.xScale > 500) gs->viewport.xScale = gs->viewport.yScale = 500;
+
+    if (zoomed) {
+        gs->needs_update = true;
+    }
+}
+
+
+static inline Clay_Dimensions SDL_MeasureText(Clay_StringSlice text, Clay_TextElementConfig *config, void *userData)
+{
+    TTF_Font **fonts = userData;
+    TTF_Font *font = fonts[config->fontId];
+    int width, height;
+
+    TTF_SetFontSize(font, config->fontSize);
+    if (!TTF_GetStringSize(font, text.chars, text.length, &width, &height)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to measure text: %s", SDL_GetError());
+    }
+
+    return (Clay_Dimensions) { (float) width, (float) height };
+}
+
+void HandleClayErrors(Clay_ErrorData errorData) {
+    printf("%s", errorData.errorText.chars);
+}
+
+Clay_RenderCommandArray ClayImageSample_CreateLayout(AppState *state) {
+    Clay_BeginLayout();
+
+    Clay_Sizing layoutExpand = {
+        .width = CLAY_SIZING_GROW(0),
+        .height = CLAY_SIZING_GROW(0)
+    };
+
+    CLAY(CLAY_ID("OuterContainer"), {
+        .layout = {
+            .layoutDirection = CLAY_TOP_TO_BOTTOM,
+            .sizing = layoutExpand,
+            .padding = CLAY_PADDING_ALL(16),
+            .childGap = 16
+        }
+    }) {
+        CLAY(CLAY_ID("SampleImage"), {
+            .layout = {
+                .sizing = layoutExpand
+            },
+            .aspectRatio = { 23.0 / 42.0 },
+            .image = {
+                .imageData = sample_image,
+            }
+        });
+    }
+
+    return Clay_EndLayout();
+}
+
+Clay_RenderCommandArray ClayGraph_CreateLayout(AppState *state) {
+    Clay_BeginLayout();
+
+    Clay_Sizing layoutExpand = {
+        .width = CLAY_SIZING_GROW(0),
+        .height = CLAY_SIZING_GROW(0)
+    };
+
+    CLAY(CLAY_ID("OuterContainer"), {
+        .layout = {
+            .layoutDirection = CLAY_TOP_TO_BOTTOM,
+            .sizing = layoutExpand,
+            .padding = CLAY_PADDING_ALL(16),
+            .childGap = 16
+        },
+        .backgroundColor = COLOR_LIGHT
+    }) {
+        static char title[512];
+        snprintf(title, sizeof(title), "Graph Plotter: %s", state->graphState.function);
+        Clay_String titleString = {
+            .chars = title, 
+            .length = strlen(title),
+            .isStaticallyAllocated = true
+        };
+
+        CLAY_TEXT(titleString, CLAY_TEXT_CONFIG({
+            .fontId = FONT_ID,
+            .fontSize = 32,
+            .textColor = {50, 50, 50, 255}
+        }));
+
+        CLAY_TEXT(CLAY_STRING("WASD to pan • Z/X to zoom • M for f(x, y) field • I to integrate, drag to set bounds • T to animate t • Space to toggle • Hover for tangent"), CLAY_TEXT_CONFIG({
+            .fontId = FONT_ID,
+            .fontSize = 16,
+            .textColor = {100, 100, 100, 255}
+        }));
+
+        CLAY(CLAY_ID("GraphContainer"), {
+            .layout = {
+                .sizing = layoutExpand
+            },
+            .image = {
+                .imageData = state->graphState.graph_texture,
+            }
+        });
+
+        static char func_display[512];
+        if (state->graphState.mode == GRAPH_MODE_FIELD) {
+            const FieldStats *fs = &state->graphState.stats.field;
+            snprintf(func_display, sizeof(func_display),
+                     "f(x, y) = %s    [%d/%d tiles, %.2f Mevals in %.1f ms, frame %.1f ms]",
+                     state->graphState.function, fs->tiles_evaluated, fs->tiles_visible,
+                     fs->evaluations / 1e6, fs->eval_ms, fs->total_ms);
+        } else if (state->graphState.show_integral && state->graphState.stats.integral.valid) {
+            const IntegralStats *is = &state->graphState.stats.integral;
+            snprintf(func_display, sizeof(func_display),
+                     "f(x) = %s    integral over [%.4g, %.4g] = %.10g ± %.1e    [%llu evals, %d/%d panels, %.2f ms]",
+                     state->graphState.function, state->graphState.integral_a, state->graphState.integral_b,
+                     is->value, is->error, (unsigned long long)is->evaluations,
+                     is->panels_computed, is->panels, is->ms);
+        } else {
+            snprintf(func_display, sizeof(func_display), "f(x) = %s", state->graphState.function);
+        }
+        Clay_String funcString = {
+            .chars = func_display,
+            .length = strlen(func_display),
+            .isStaticallyAllocated = true
+        };
+
+        CLAY(CLAY_ID("BottomBar"), {
+            .layout = {
+                .sizing = { .width = CLAY_SIZING_GROW(0) },
+                .childGap = 16,
+                .childAlignment = { .y = CLAY_ALIGN_Y_CENTER }
+            }
+        }) {
+            CLAY(CLAY_ID("FunctionLabel"), {
+                .layout = {
+                    .sizing = { .width = CLAY_SIZING_GROW(0) }
+                }
+            }) {
+                CLAY_TEXT(funcString, CLAY_TEXT_CONFIG({
+                    .fontId = FONT_ID,
+                    .fontSize = 20,
+                    .textColor = {50, 50, 50, 255}
+                }));
+            }
+
+            static char param_labels[GRAPH_PARAM_COUNT][32];
+            for (int i = 0; i < GRAPH_PARAM_COUNT; i++) {
+                const GraphState *gs = &state->graphState;
+                snprintf(param_labels[i], sizeof(param_labels[i]), "%s = %.2f%s", GRAPH_PARAM_NAMES[i],
+                         gs->params[i], i == 0 && gs->animating ? " >" : "");
+                Clay_String label = {
+                    .chars = param_labels[i],
+                    .length = strlen(param_labels[i]),
+                    .isStaticallyAllocated = true
+                };
+                const float fill = (float)SDL_clamp((gs->params[i] - GRAPH_PARAM_MIN[i]) /
+                                                    (GRAPH_PARAM_MAX[i] - GRAPH_PARAM_MIN[i]), 0.0, 1.0);
+
+                CLAY(CLAY_IDI("ParamSlider", i), {
+                    .layout = {
+                        .childGap = 8,
+                        .childAlignment = { .y = CLAY_ALIGN_Y_CENTER }
+                    }
+                }) {
+                    CLAY(CLAY_IDI("ParamLabel", i), {
+                        .layout = {
+                            .sizing = { .width = CLAY_SIZING_FIXED(72) }
+                        }
+                    }) {
+                        CLAY_TEXT(label, CLAY_TEXT_CONFIG({
+                            .fontId = FONT_ID,
+                            .fontSize = 16,
+                            .textColor = {50, 50, 50, 255}
+                        }));
+                    }
+
+                    CLAY(CLAY_IDI("ParamTrack", i), {
+                        .layout = {
+                            .sizing = { CLAY_SIZING_FIXED(120), CLAY_SIZING_FIXED(10) }
+                        },
+                        .backgroundColor = {180, 170, 165, 255},
+                        .cornerRadius = CLAY_CORNER_RADIUS(5)
+                    }) {
+                        CLAY(CLAY_IDI("ParamFill", i), {
+                            .layout = {
+                                .sizing = { CLAY_SIZING_PERCENT(fill), CLAY_SIZING_GROW(0) }
+                            },
+                            .backgroundColor = gs->dragging_param == i ? COLOR_ORANGE : COLOR_BLUE,
+                            .cornerRadius = CLAY_CORNER_RADIUS(5)
+                        });
+                    }
+                }
+            }
+        }
+    }
+
+    return Clay_EndLayout();
+}
+
+static const char *get_cmd_arg(int argc, char *argv[], const char *prefix)
+{
+    size_t len = strlen(prefix);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], prefix, len) == 0) {
+            return argv[i] + len;
+        }
+    }
+    return NULL;
+}
+
+static void get_view_size(const AppState *state, int *width, int *height)
+{
+    if (state->trace.mode == TRACE_REPLAY) {
+        *width = state->trace.width;
+        *height = state->trace.height;
+    } else {
+        SDL_GetWindowSize(state->window, width, height);
+    }
+}
+
+/* Left click in the graph grabs the nearer integral bound, or starts a new interval there. */
+static void begin_integral_drag(AppState *state, float mouse_x, float mouse_y)
+{
+    GraphState *gs = &state->graphState;
+    int width, height;
+    get_view_size(state, &width, &height);
+    SDL_Rect area = graph_area(width, height);
+
+    SDL_Point p = { (int)mouse_x, (int)mouse_y };
+    if (!SDL_PointInRect(&p, &area)) return;
+
+    const double x = screen_to_math(&gs->viewport, mouse_x - area.x, 0, area.w, area.h).x;
+    const double grab = 10.0 / gs->viewport.xScale;
+
+    if (fabs(x - gs->integral_a) <= grab && fabs(x - gs->integral_a) <= fabs(x - gs->integral_b)) {
+        gs->dragging_bound = 0;
+    } else if (fabs(x - gs->integral_b) <= grab) {
+        gs->dragging_bound = 1;
+    } else {
+        gs->integral_a = gs->integral_b = x;
+        gs->dragging_bound = 1;
+    }
+    gs->needs_update = true;
+}
+
+static void update_integral_drag(AppState *state, float mouse_x)
+{
+    GraphState *gs = &state->graphState;
+    int width, height;
+    get_view_size(state, &width, &height);
+    SDL_Rect area = graph_area(width, height);
+
+    const double x = screen_to_math(&gs->viewport, mouse_x - area.x, 0, area.w, area.h).x;
+    if (gs->dragging_bound == 0) gs->integral_a = x;
+    else gs->integral_b = x;
+    gs->needs_update = true;
+}
+
+/* Sets the dragged parameter from where the pointer sits on its slider track. */
+static void update_param_drag(AppState *state, float mouse_x)
+{
+    GraphState *gs = &state->graphState;
+    const int i = gs->dragging_param;
+    Clay_ElementData track = Clay_GetElementData(CLAY_IDI("ParamTrack", i));
+    if (!track.found || track.boundingBox.width <= 0) return;
+
+    const double f = SDL_clamp((mouse_x - track.boundingBox.x) / track.boundingBox.width, 0.0, 1.0);
+    gs->params[i] = GRAPH_PARAM_MIN[i] + f * (GRAPH_PARAM_MAX[i] - GRAPH_PARAM_MIN[i]);
+    gs->needs_update = true;
+}
+
+/* Left click on a slider track grabs that parameter. Returns false if no slider was hit. */
+static bool begin_param_drag(AppState *state, float mouse_x)
+{
+    for (int i = 0; i < GRAPH_PARAM_COUNT; i++) {
+        if (Clay_PointerOver(CLAY_IDI("ParamTrack", i))) {
+            state->graphState.dragging_param = i;
+            update_param_drag(state, mouse_x);
+            return true;
+        }
+    }
+    return false;
+}
+
+static SDL_AppResult handle_event(AppState *state, const SDL_Event *event)
+{
+    switch (event->type) {
+        case SDL_EVENT_QUIT:
+            return SDL_APP_SUCCESS;
+            
+        case SDL_EVENT_KEY_UP:
+            if (event->key.scancode == SDL_SCANCODE_SPACE) {
+                show_demo = !show_demo;
+                if (!show_demo) show_graph = !show_graph;
+            }
+            if (event->key.scancode == SDL_SCANCODE_M && show_graph) {
+                state->graphState.mode = state->graphState.mode == GRAPH_MODE_FIELD
+                    ? GRAPH_MODE_CURVE : GRAPH_MODE_FIELD;
+                state->graphState.needs_update = true;
+            }
+            if (event->key.scancode == SDL_SCANCODE_I && show_graph) {
+                state->graphState.show_integral = !state->graphState.show_integral;
+                state->graphState.dragging_bound = -1;
+                state->graphState.needs_update = true;
+            }
+            if (event->key.scancode == SDL_SCANCODE_T && show_graph) {
+                state->graphState.animating = !state->graphState.animating;
+            }
+            break;
+            
+        case SDL_EVENT_WINDOW_RESIZED:
+            Clay_SetLayoutDimensions((Clay_Dimensions) { 
+                (float) event->window.data1, 
+                (float) event->window.data2 
+            });
+            state->graphState.needs_update = true;
+            break;
+            
+        case SDL_EVENT_MOUSE_MOTION:
+            Clay_SetPointerState((Clay_Vector2) { event->motion.x, event->motion.y },
+                                 event->motion.state & SDL_BUTTON_LMASK);
+            state->graphState.mouseX = event->motion.x;
+            state->graphState.mouseY = event->motion.y;
+            state->graphState.mouse_in_window = true;
+            if (state->graphState.dragging_param >= 0 && (event->motion.state & SDL_BUTTON_LMASK)) {
+                update_param_drag(state, event->motion.x);
+            } else if (state->graphState.dragging_bound >= 0 && (event->motion.state & SDL_BUTTON_LMASK)) {
+                update_integral_drag(state, event->motion.x);
+            }
+            break;
+            
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            Clay_SetPointerState((Clay_Vector2) { event->button.x, event->button.y },
+                                 event->button.button == SDL_BUTTON_LEFT);
+            state->graphState.mouseX = event->button.x;
+            state->graphState.mouseY = event->button.y;
+            if (event->button.button != SDL_BUTTON_LEFT || !show_graph) break;
+            if (begin_param_drag(state, event->button.x)) break;
+            if (state->graphState.show_integral && state->graphState.mode == GRAPH_MODE_CURVE) {
+                begin_integral_drag(state, event->button.x, event->button.y);
+            }
+            break;
+
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            if (event->button.button == SDL_BUTTON_LEFT) {
+                state->graphState.dragging_bound = -1;
+                state->graphState.dragging_param = -1;
+            }
+            break;
+            
+        case SDL_EVENT_WINDOW_MOUSE_LEAVE:
+            state->graphState.mouse_in_window = false;
+            break;
+            
+        case SDL_EVENT_MOUSE_WHEEL:
+            Clay_UpdateScrollContainers(true, (Clay_Vector2) { event->wheel.x, event->wheel.y }, 0.01f);
+            break;
+            
+        default:
+            break;
+    }
+
+    return SDL_APP_CONTINUE;
+}
+
+static void step_graph(AppState *state, const bool *keys, double dt)
+{
+    if (show_graph) {
+        update_graph_movement(&state->graphState, keys, dt);
+        update_graph_zoom(&state->graphState, keys, dt);
+        update_graph_animation(&state->graphState, dt);
+    }
+}
+
+/* =========================
+   Input Trace Record / Replay
+   ========================= */
+
+#define TRACE_VERSION 2
+
+/* Keys polled by update_graph_movement and update_graph_zoom, stored as a bitmask per frame. */
+static const SDL_Scancode TRACE_KEYS[] = {
+    SDL_SCANCODE_A, SDL_SCANCODE_D, SDL_SCANCODE_W, SDL_SCANCODE_S, SDL_SCANCODE_Z, SDL_SCANCODE_X
+};
+#define TRACE_KEY_COUNT (int)(sizeof(TRACE_KEYS) / sizeof(TRACE_KEYS[0]))
+
+static const char *const PRECISION_NAMES[] = { "exact", "high", "fast" };   // by te_precision
+
+/* Parses exact, high, fast or auto as given to --precision and stored in traces. */
+static bool parse_precision(const char *name, bool *precision_auto, te_precision *precision)
+{
+    if (strcmp(name, "auto") == 0) {
+        *precision_auto = true;
+        return true;
+    }
+    for (int i = 0; i < (int)SDL_arraysize(PRECISION_NAMES); i++) {
+        if (strcmp(name, PRECISION_NAMES[i]) == 0) {
+            *precision_auto = false;
+            *precision = (te_precision)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Reads count space-separated doubles from text. Returns the rest of the line, or NULL. */
+static const char *trace_parse_doubles(const char *text, double *values, int count)
+{
+    for (int i = 0; i < count; i++) {
+        int consumed = 0;
+        if (sscanf(text, " %lf%n", &values[i], &consumed) != 1) return NULL;
+        text += consumed;
+    }
+    return text;
+}
+
+bool trace_open_record(InputTrace *trace, const char *path, const GraphState *gs, int width, int height)
+{
+    trace->file = fopen(path, "w");
+    if (!trace->file) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to open trace %s for writing", path);
+        return false;
+    }
+
+    trace->mode = TRACE_RECORD;
+    fprintf(trace->file, "grapher-trace %d\n", TRACE_VERSION);
+    fprintf(trace->file, "size %d %d\n", width, height);
+    fprintf(trace->file, "mode %s\n", gs->mode == GRAPH_MODE_FIELD ? "field" : "curve");
+    fprintf(trace->file, "func %s\n", gs->function);
+    fprintf(trace->file, "precision %s\n", gs->precision_auto ? "auto" : PRECISION_NAMES[gs->precision]);
+    fprintf(trace->file, "params");
+    for (int i = 0; i < GRAPH_PARAM_COUNT; i++) fprintf(trace->file, " %.17g", gs->params[i]);
+    fprintf(trace->file, "\n");
+    return true;
+}
+
+/* Reads the header into gs (function, mode, precision and initial parameters)
+   and leaves the file positioned at the first frame. */
+bool trace_open_replay(InputTrace *trace, const char *path, GraphState *gs)
+{
+    trace->file = fopen(path, "r");
+    if (!trace->file) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to open trace %s", path);
+        return false;
+    }
+
+    int version = 0;
+    char mode[16] = "", precision[16] = "";
+    char func[512], line[512];
+    if (!fgets(line, sizeof(line), trace->file) || sscanf(line, "grapher-trace %d", &version) != 1 ||
+        version != TRACE_VERSION ||
+        !fgets(line, sizeof(line), trace->file) || sscanf(line, "size %d %d", &trace->width, &trace->height) != 2 ||
+        !fgets(line, sizeof(line), trace->file) || sscanf(line, "mode %15s", mode) != 1 ||
+        !fgets(func, sizeof(func), trace->file) || strncmp(func, "func ", 5) != 0 ||
+        !fgets(line, sizeof(line), trace->file) || sscanf(line, "precision %15s", precision) != 1 ||
+        !parse_precision(precision, &gs->precision_auto, &gs->precision) ||
+        !fgets(line, sizeof(line), trace->file) || strncmp(line, "params", 6) != 0 ||
+        !trace_parse_doubles(line + 6, gs->params, GRAPH_PARAM_COUNT)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "%s is not a version %d trace", path, TRACE_VERSION);
+        fclose(trace->file);
+        trace->file = NULL;
+        return false;
+    }
+
+    func[strcspn(func, "\r\n")] = '\0';
+    SDL_strlcpy(gs->function, func + 5, sizeof(gs->function));
+    gs->mode = strcmp(mode, "field") == 0 ? GRAPH_MODE_FIELD : GRAPH_MODE_CURVE;
+    trace->mode = TRACE_REPLAY;
+    return true;
+}
+
+void trace_close(InputTrace *trace)
+{
+    if (trace->file) fclose(trace->file);
+    trace->file = NULL;
+    trace->mode = TRACE_NONE;
+}
+
+void trace_record_event(InputTrace *trace, const SDL_Event *event)
+{
+    if (trace->mode != TRACE_RECORD) return;
+
+    FILE *f = trace->file;
+    switch (event->type) {
+        case SDL_EVENT_QUIT:
+            fprintf(f, "event %llu quit\n", (unsigned long long)trace->frame);
+            break;
+        case SDL_EVENT_KEY_UP:
+            fprintf(f, "event %llu key_up %d\n", (unsigned long long)trace->frame, (int)event->key.scancode);
+            break;
+        case SDL_EVENT_WINDOW_RESIZED:
+            fprintf(f, "event %llu resize %d %d\n", (unsigned long long)trace->frame,
+                    event->window.data1, event->window.data2);
+            break;
+        case SDL_EVENT_MOUSE_MOTION:
+            fprintf(f, "event %llu motion %.9g %.9g %u\n", (unsigned long long)trace->frame,
+                    event->motion.x, event->motion.y, (unsigned)event->motion.state);
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            fprintf(f, "event %llu button_down %.9g %.9g %d\n", (unsigned long long)trace->frame,
+                    event->button.x, event->button.y, (int)event->button.button);
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            fprintf(f, "event %llu button_up %.9g %.9g %d\n", (unsigned long long)trace->frame,
+                    event->button.x, event->button.y, (int)event->button.button);
+            break;
+        case SDL_EVENT_WINDOW_MOUSE_LEAVE:
+            fprintf(f, "event %llu mouse_leave\n", (unsigned long long)trace->frame);
+            break;
+        case SDL_EVENT_MOUSE_WHEEL:
+            fprintf(f, "event %llu wheel %.9g %.9g\n", (unsigned long long)trace->frame,
+                    event->wheel.x, event->wheel.y);
+            break;
+        default:
+            break;
+    }
+}
+
+void trace_record_frame(InputTrace *trace, Uint64 ticks, double dt, const bool *keys)
+{
+    if (trace->mode != TRACE_RECORD) return;
+
+    unsigned mask = 0;
+    for (int i = 0; i < TRACE_KEY_COUNT; i++) {
+        if (keys[TRACE_KEYS[i]]) mask |= 1u << i;
+    }
+    fprintf(trace->file, "frame %llu %llu %.17g %x\n",
+            (unsigned long long)trace->frame, (unsigned long long)ticks, dt, mask);
+}
+
+/* State checked on replay: the viewport, whether t is animating and the parameters. */
+void trace_record_view(InputTrace *trace, const GraphState *gs)
+{
+    if (trace->mode != TRACE_RECORD) return;
+
+    const Viewport *v = &gs->viewport;
+    fprintf(trace->file, "view %.17g %.17g %.17g %.17g %d", v->cx, v->cy, v->xScale, v->yScale, gs->animating);
+    for (int i = 0; i < GRAPH_PARAM_COUNT; i++) fprintf(trace->file, " %.17g", gs->params[i]);
+    fprintf(trace->file, "\n");
+    trace->frame++;
+}
+
+/* Rebuilds the SDL_Event recorded by trace_record_event. */
+static bool trace_parse_event(const char *line, SDL_Event *event)
+{
+    char kind[32];
+    int consumed = 0;
+    unsigned long long frame;
+    if (sscanf(line, "event %llu %31s %n", &frame, kind, &consumed) != 2) return false;
+
+    const char *args = line + consumed;
+    SDL_zerop(event);
+
+    if (strcmp(kind, "quit") == 0) {
+        event->type = SDL_EVENT_QUIT;
+    } else if (strcmp(kind, "key_up") == 0) {
+        int scancode;
+        if (sscanf(args, "%d", &scancode) != 1) return false;
+        event->type = SDL_EVENT_KEY_UP;
+        event->key.scancode = (SDL_Scancode)scancode;
+    } else if (strcmp(kind, "resize") == 0) {
+        event->type = SDL_EVENT_WINDOW_RESIZED;
+        if (sscanf(args, "%d %d", &event->window.data1, &event->window.data2) != 2) return false;
+    } else if (strcmp(kind, "motion") == 0) {
+        unsigned buttons;
+        event->type = SDL_EVENT_MOUSE_MOTION;
+        if (sscanf(args, "%f %f %u", &event->motion.x, &event->motion.y, &buttons) != 3) return false;
+        event->motion.state = buttons;
+    } else if (strcmp(kind, "button_down") == 0 || strcmp(kind, "button_up") == 0) {
+        int button;
+        event->type = kind[7] == 'd' ? SDL_EVENT_MOUSE_BUTTON_DOWN : SDL_EVENT_MOUSE_BUTTON_UP;
+        if (sscanf(args, "%f %f %d", &event->button.x, &event->button.y, &button) != 3) return false;
+        event->button.button = (Uint8)button;
+    } else if (strcmp(kind, "mouse_leave") == 0) {
+        event->type = SDL_EVENT_WINDOW_MOUSE_LEAVE;
+    } else if (strcmp(kind, "wheel") == 0) {
+        event->type = SDL_EVENT_MOUSE_WHEEL;
+        if (sscanf(args, "%f %f", &event->wheel.x, &event->wheel.y) != 2) return false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+/* Feeds a recorded trace through the same update path as SDL_AppIterate without
+   a window. The graph is rendered synchronously so its cost lands in the frame
+   that asked for it. Prints a per-frame CSV timing report and a summary to stdout.
+   fixed_dt > 0 replaces the recorded dt, which also disables viewport verification.
+
+   async instead submits to the background renderer like SDL_AppIterate, paces
+   frames to dt in wall-clock time and reports how many frames completed and the
+   longest wait for one; it fails if frames were submitted but none completed. */
+SDL_AppResult run_replay(AppState *state, double fixed_dt, bool async)
+{
+    InputTrace *trace = &state->trace;
+    static bool keys[SDL_SCANCODE_COUNT];
+    const double freq = (double)SDL_GetPerformanceFrequency();
+
+    size_t capacity = 1024, frames = 0;
+    double *frame_ms = malloc(sizeof(double) * capacity);
+    if (!frame_ms) return SDL_APP_FAILURE;
+
+    Uint64 mismatches = 0;
+    bool replay_ok = true;
+    char line[512];
+
+    GraphRenderer *gr = &state->graphState.renderer;
+    Uint64 submitted = 0, completed = 0;
+    Uint64 waiting_since = 0, longest_wait = 0;     // performance counter, 0 = nothing outstanding
+
+    printf("frame,dt,update_ms,render_ms,layout_ms,total_ms\n");
+
+    while (fgets(line, sizeof(line), trace->file)) {
+        if (strncmp(line, "event ", 6) == 0) {
+            SDL_Event event;
+            if (!trace_parse_event(line, &event)) {
+                SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Bad trace line: %s", line);
+                replay_ok = false;
+                break;
+            }
+            if (event.type == SDL_EVENT_WINDOW_RESIZED) {
+                trace->width = event.window.data1;
+                trace->height = event.window.data2;
+            }
+            if (handle_event(state, &event) != SDL_APP_CONTINUE) break;
+
+        } else if (strncmp(line, "frame ", 6) == 0) {
+            unsigned long long index, ticks;
+            double dt;
+            unsigned mask;
+            if (sscanf(line, "frame %llu %llu %lf %x", &index, &ticks, &dt, &mask) != 4) {
+                SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Bad trace line: %s", line);
+                replay_ok = false;
+                break;
+            }
+            if (fixed_dt > 0) dt = fixed_dt;
+            for (int i = 0; i < TRACE_KEY_COUNT; i++) {
+                keys[TRACE_KEYS[i]] = (mask >> i) & 1;
+            }
+
+            const Uint64 t0 = SDL_GetPerformanceCounter();
+            step_graph(state, keys, dt);
+
+            const Uint64 t1 = SDL_GetPerformanceCounter();
+            if (show_graph && state->graphState.needs_update) {
+                int width, height;
+                get_view_size(state, &width, &height);
+                GraphJob job = make_graph_job(&state->graphState, width - 32, height - 150);
+                if (async) {
+                    graph_renderer_submit(gr, &job);
+                    if (!waiting_since) waiting_since = t1;
+                    submitted++;
+                } else {
+                    SDL_Surface *surface = graph_renderer_render_now(gr, &job, &state->graphState.stats);
+                    if (surface) SDL_DestroySurface(surface);
+                }
+                state->graphState.needs_update = false;
+            }
+            if (async) {
+                SDL_Surface *surface = graph_renderer_take(gr, &state->graphState.stats);
+                if (surface) {
+                    const Uint64 now = SDL_GetPerformanceCounter();
+                    longest_wait = SDL_max(longest_wait, now - waiting_since);
+                    waiting_since = graph_renderer_idle(gr) ? 0 : now;
+                    completed++;
+                    SDL_DestroySurface(surface);
+                }
+            }
+
+            const Uint64 t2 = SDL_GetPerformanceCounter();
+            if (show_demo) {
+                ClayVideoDemo_CreateLayout(&state->demoData);
+            } else if (show_graph) {
+                ClayGraph_CreateLayout(state);
+            } else {
+                ClayImageSample_CreateLayout(state);
+            }
+            const Uint64 t3 = SDL_GetPerformanceCounter();
+
+            if (frames == capacity) {
+                capacity *= 2;
+                double *grown = realloc(frame_ms, sizeof(double) * capacity);
+                if (!grown) break;
+                frame_ms = grown;
+            }
+            frame_ms[frames++] = (t3 - t0) * 1000.0 / freq;
+
+            printf("%llu,%.6f,%.3f,%.3f,%.3f,%.3f\n", index, dt,
+                   (t1 - t0) * 1000.0 / freq, (t2 - t1) * 1000.0 / freq,
+                   (t3 - t2) * 1000.0 / freq, (t3 - t0) * 1000.0 / freq);
+            trace->frame = index;
+
+            if (async) {
+                const Uint64 elapsed_ns = (Uint64)((SDL_GetPerformanceCounter() - t0) * 1e9 / freq);
+                if (elapsed_ns < (Uint64)(dt * 1e9)) SDL_DelayPrecise((Uint64)(dt * 1e9) - elapsed_ns);
+            }
+
+        } else if (strncmp(line, "view ", 5) == 0) {
+            Viewport want;
+            int animating, consumed = 0;
+            double params[GRAPH_PARAM_COUNT];
+            if (sscanf(line, "view %lf %lf %lf %lf %d%n", &want.cx, &want.cy, &want.xScale, &want.yScale,
+                       &animating, &consumed) != 5 ||
+                !trace_parse_doubles(line + consumed, params, GRAPH_PARAM_COUNT)) {
+                SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Bad trace line: %s", line);
+                replay_ok = false;
+                break;
+            }
+            const GraphState *gs = &state->graphState;
+            const Viewport *got = &gs->viewport;
+            if (fixed_dt <= 0 && (got->cx != want.cx || got->cy != want.cy ||
+                                  got->xScale != want.xScale || got->yScale != want.yScale)) {
+                if (mismatches == 0) {
+                    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                                 "Viewport diverged at frame %llu: got (%.17g, %.17g, %.17g), want (%.17g, %.17g, %.17g)",
+                                 (unsigned long long)trace->frame, got->cx, got->cy, got->xScale,
+                                 want.cx, want.cy, want.xScale);
+                }
+                mismatches++;
+            } else if (fixed_dt <= 0 && gs->animating != (animating != 0)) {
+                if (mismatches == 0) {
+                    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Animation diverged at frame %llu: got %s, want %s",
+                                 (unsigned long long)trace->frame, gs->animating ? "on" : "off",
+                                 animating ? "on" : "off");
+                }
+                mismatches++;
+            } else if (fixed_dt <= 0 && SDL_memcmp(gs->params, params, sizeof(params)) != 0) {
+                if (mismatches == 0) {
+                    int i = 0;
+                    while (gs->params[i] == params[i]) i++;
+                    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Parameter %s diverged at frame %llu: got %.17g, want %.17g",
+                                 GRAPH_PARAM_NAMES[i], (unsigned long long)trace->frame, gs->params[i], params[i]);
+                }
+                mismatches++;
+            }
+        }
+    }
+
+    if (frames > 0) {
+        double total = 0;
+        for (size_t i = 0; i < frames; i++) total += frame_ms[i];
+        qsort(frame_ms, frames, sizeof(double), compare_doubles);
+        printf("# frames %zu, mean %.3f ms, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+               frames, total / frames,
+               frame_ms[(frames - 1) * 50 / 100], frame_ms[(frames - 1) * 90 / 100],
+               frame_ms[(frames - 1) * 99 / 100], frame_ms[frames - 1]);
+    }
+    if (fixed_dt <= 0) {
+        printf("# view mismatches %llu\n", (unsigned long long)mismatches);
+    }
+    free(frame_ms);
+
+    if (async) {
+        while (!graph_renderer_idle(gr)) SDL_Delay(1);
+        SDL_Surface *surface = graph_renderer_take(gr, NULL);
+        if (surface) {
+            if (waiting_since) longest_wait = SDL_max(longest_wait, SDL_GetPerformanceCounter() - waiting_since);
+            completed++;
+            SDL_DestroySurface(surface);
+        }
+        printf("# async frames submitted %llu, completed %llu, longest wait %.3f ms\n",
+               (unsigned long long)submitted, (unsigned long long)completed, longest_wait * 1000.0 / freq);
+        if (submitted > 0 && completed == 0) replay_ok = false;
+    }
+
+    return (replay_ok && mismatches == 0) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+}
+
+/* =========================
+   Plot Server
+   ========================= */
+
+/* --serve=/path.sock answers newline-terminated requests on a UNIX domain socket:
+
+     render <png|rgba> <width> <height> <cx> <cy> <xScale> <yScale> <curve|field> <expression>
+     stats
+     shutdown
+
+   Each reply is a header line "ok <kind> <width> <height> <bytes>" followed by
+   <bytes> of payload (PNG, packed RGBA32 rows or stats text), or a single
+   "error <message>" line. A connection stays open for further requests, but is
+   closed after an "error idle timeout" when no full request line arrives within
+   SERVE_IDLE_MS, so idle clients cannot hold on to the worker threads.
+
+   Connections are served in parallel, cache misses included: each connection
+   worker renders with its own label font and caches, and only the worker pool
+   is shared, so the parallel sections of concurrent frames take turns on it.
+   Two workers missing on the same request at once both render it. */
+
+static bool serve_send_all(ServeSocket s, const void *data, size_t size)
+{
+    const char *p = data;
+    while (size > 0) {
+        int sent = send(s, p, (int)SDL_min(size, (size_t)1 << 20), SERVE_SEND_FLAGS);
+        if (sent <= 0) return false;
+        p += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+static bool serve_reply(ServeConnection *c, const char *kind, int width, int height, const void *data, size_t size)
+{
+    char header[96];
+    int len = snprintf(header, sizeof(header), "ok %s %d %d %zu\n", kind, width, height, size);
+    return serve_send_all(c->socket, header, (size_t)len) && serve_send_all(c->socket, data, size);
+}
+
+static bool serve_reply_error(ServeConnection *c, const char *message)
+{
+    char line[320];
+    int len = snprintf(line, sizeof(line), "error %s\n", message);
+    return serve_send_all(c->socket, line, (size_t)SDL_min(len, (int)sizeof(line) - 1));
+}
+
+/* Reads one line without its terminator. The socket's receive timeout is
+   SERVE_IDLE_MS, so each recv returns in time to check the deadline. */
+static ServeRead serve_read_line(ServeConnection *c, char *line, size_t capacity)
+{
+    const Uint64 deadline = SDL_GetTicks() + SERVE_IDLE_MS;
+    for (;;) {
+        char *begin = c->buffer + c->start;
+        char *newline = memchr(begin, '\n', c->length - c->start);
+        if (newline) {
+            size_t len = (size_t)(newline - begin);
+            c->start += len + 1;
+            if (len > 0 && begin[len - 1] == '\r') len--;
+            if (len >= capacity) return SERVE_READ_TOO_LONG;
+            memcpy(line, begin, len);
+            line[len] = '\0';
+            return SERVE_READ_LINE;
+        }
+
+        memmove(c->buffer, begin, c->length - c->start);
+        c->length -= c->start;
+        c->start = 0;
+        if (c->length == sizeof(c->buffer)) return SERVE_READ_TOO_LONG;
+        if (SDL_GetTicks() >= deadline) return SERVE_READ_IDLE;
+
+        int got = recv(c->socket, c->buffer + c->length, (int)(sizeof(c->buffer) - c->length), 0);
+        if (got == 0) return SERVE_READ_CLOSED;
+        if (got < 0) return SDL_GetTicks() >= deadline ? SERVE_READ_IDLE : SERVE_READ_CLOSED;
+        c->length += (size_t)got;
+    }
+}
+
+static void serve_set_timeout(ServeSocket s, int ms)
+{
+#ifdef _WIN32
+    DWORD timeout = (DWORD)ms;
+#else
+    struct timeval timeout = { .tv_sec = ms / 1000, .tv_usec = (ms % 1000) * 1000 };
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+}
+
+/* hit is only meaningful for requests that got as far as the image cache. */
+static void serve_record(PlotServer *server, Uint64 start, bool ok, bool hit, const FieldStats *field)
+{
+    const double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+    SDL_LockMutex(server->lock);
+    if (!ok) server->errors++;
+    else if (hit) server->image_hits++;
+    else server->image_misses++;
+    server->latency_ms[server->latency_count++ % SERVE_LATENCY_RING] = ms;
+    if (field) {
+        server->tiles_visible += field->tiles_visible;
+        server->tiles_evaluated += field->tiles_evaluated;
     }
-    if (keys[SDL_SCANCODE_X]) {
-        double factor = exp(-zoomSpeed * dt);
-        gs->viewport.xScale *= factor;
-        gs->viewport.yScale *= factor;
-        zoomed = true;
+    SDL_UnlockMutex(server->lock);
+}
+
+/* Copies a cached reply out under the lock, since another worker may evict it right after. */
+static Uint8 *serve_lookup_image(PlotServer *server, const char *key, size_t *size, int *width, int *height)
+{
+    Uint8 *copy = NULL;
+
+    SDL_LockMutex(server->lock);
+    for (int i = 0; i < SERVE_IMAGE_CACHE; i++) {
+        ServeImage *image = &server->images[i];
+        if (image->last_used && strcmp(image->key, key) == 0) {
+            copy = malloc(image->size);
+            if (copy) {
+                memcpy(copy, image->data, image->size);
+                *size = image->size;
+                *width = image->width;
+                *height = image->height;
+                image->last_used = ++server->clock;
+            }
+            break;
+        }
     }
+    SDL_UnlockMutex(server->lock);
 
-    if (gs->viewport.xScale < 10)  gs->viewport.xScale = gs->viewport.yScale = 10;
-    if (gs->viewport.xScale > 500) gs->viewport.xScale = gs->viewport.yScale = 500;
+    return copy;
+}
 
-    if (zoomed) {
-        gs->needs_update = true;
+static void serve_evict_image(PlotServer *server, ServeImage *image)
+{
+    server->image_bytes -= image->size;
+    free(image->data);
+    SDL_zerop(image);
+}
+
+static void serve_store_image(PlotServer *server, const char *key, const Uint8 *data, size_t size,
+                              int width, int height)
+{
+    if (size > SERVE_CACHE_BYTES / 4) return;
+    Uint8 *copy = malloc(size);
+    if (!copy) return;
+    memcpy(copy, data, size);
+
+    SDL_LockMutex(server->lock);
+    for (int i = 0; i < SERVE_IMAGE_CACHE; i++) {
+        // Another worker stored the same request while this one was rendering it.
+        if (server->images[i].last_used && strcmp(server->images[i].key, key) == 0) {
+            SDL_UnlockMutex(server->lock);
+            free(copy);
+            return;
+        }
+    }
+    for (;;) {
+        ServeImage *victim = NULL;
+        int used = 0;
+        for (int i = 0; i < SERVE_IMAGE_CACHE; i++) {
+            ServeImage *image = &server->images[i];
+            if (image->last_used) used++;
+            if (!victim || image->last_used < victim->last_used) victim = image;
+        }
+        if (victim->last_used && (used == SERVE_IMAGE_CACHE || server->image_bytes + size > SERVE_CACHE_BYTES)) {
+            serve_evict_image(server, victim);
+            continue;
+        }
+
+        SDL_strlcpy(victim->key, key, sizeof(victim->key));
+        victim->data = copy;
+        victim->size = size;
+        victim->width = width;
+        victim->height = height;
+        victim->last_used = ++server->clock;
+        server->image_bytes += size;
+        break;
     }
+    SDL_UnlockMutex(server->lock);
 }
 
+static Uint8 *serve_encode(SDL_Surface *surface, bool png, size_t *size)
+{
+    if (png) {
+        SDL_IOStream *io = SDL_IOFromDynamicMem();
+        if (!io) return NULL;
+
+        Uint8 *data = NULL;
+        if (IMG_SavePNG_IO(surface, io, false)) {
+            const void *mem = SDL_GetPointerProperty(SDL_GetIOProperties(io),
+                                                     SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, NULL);
+            *size = (size_t)SDL_GetIOSize(io);
+            data = mem ? malloc(*size) : NULL;
+            if (data) memcpy(data, mem, *size);
+        }
+        SDL_CloseIO(io);
+        return data;
+    }
+
+    const size_t row = (size_t)surface->w * 4;
+    Uint8 *data = malloc(row * surface->h);
+    if (!data) return NULL;
+    for (int y = 0; y < surface->h; y++) {
+        memcpy(data + row * y, (const Uint8 *)surface->pixels + (size_t)surface->pitch * y, row);
+    }
+    *size = row * surface->h;
+    return data;
+}
 
-static inline Clay_Dimensions SDL_MeasureText(Clay_StringSlice text, Clay_TextElementConfig *config, void *userData)
+static bool serve_handle_render(ServeWorker *worker, ServeConnection *c, const char *args)
 {
-    TTF_Font **fonts = userData;
-    TTF_Font *font = fonts[config->fontId];
+    PlotServer *server = worker->server;
+    const Uint64 start = SDL_GetPerformanceCounter();
+    char format[8], mode[8];
+    int consumed = 0;
+    GraphJob job = { 0 };
+
+    if (sscanf(args, "%7s %d %d %lf %lf %lf %lf %7s %n", format, &job.width, &job.height,
+               &job.viewport.cx, &job.viewport.cy, &job.viewport.xScale, &job.viewport.yScale,
+               mode, &consumed) != 8 || args[consumed] == '\0') {
+        serve_record(server, start, false, false, NULL);
+        return serve_reply_error(c, "usage: render <png|rgba> <width> <height> <cx> <cy> <xScale> <yScale> "
+                                    "<curve|field> <expression>");
+    }
+
+    const char *problem = NULL;
+    const bool png = strcmp(format, "png") == 0;
+    if (!png && strcmp(format, "rgba") != 0) {
+        problem = "format must be png or rgba";
+    } else if (strcmp(mode, "curve") != 0 && strcmp(mode, "field") != 0) {
+        problem = "mode must be curve or field";
+    } else if (job.width < 1 || job.height < 1 || job.width > SERVE_MAX_SIZE || job.height > SERVE_MAX_SIZE) {
+        problem = "width and height must be between 1 and 4096";
+    } else if (!isfinite(job.viewport.cx) || !isfinite(job.viewport.cy) ||
+               !(job.viewport.xScale > 0) || !isfinite(job.viewport.xScale) ||
+               !(job.viewport.yScale > 0) || !isfinite(job.viewport.yScale)) {
+        problem = "viewport must be finite with positive scales";
+    } else if (SDL_strlcpy(job.function, args + consumed, sizeof(job.function)) >= sizeof(job.function)) {
+        problem = "expression too long";
+    }
+    if (problem) {
+        serve_record(server, start, false, false, NULL);
+        return serve_reply_error(c, problem);
+    }
+
+    job.mode = strcmp(mode, "field") == 0 ? GRAPH_MODE_FIELD : GRAPH_MODE_CURVE;
+    job.precision = plot_precision(server->settings, &job);
+    SDL_memcpy(job.params, server->settings->params, sizeof(job.params));
+
+    char key[512];
+    snprintf(key, sizeof(key), "%s %d %d %.17g %.17g %.17g %.17g %s %d %s", format, job.width, job.height,
+             job.viewport.cx, job.viewport.cy, job.viewport.xScale, job.viewport.yScale, mode,
+             (int)job.precision, job.function);
+
+    size_t size;
     int width, height;
+    Uint8 *data = serve_lookup_image(server, key, &size, &width, &height);
+    SDL_Surface *surface = NULL;
+    FrameStats stats = { 0 };
+
+    if (!data) {
+        const ExprCache *exprs = &worker->caches.exprs;
+        const Uint64 expr_hits = exprs->hits, expr_misses = exprs->misses;
+        surface = render_graph_to_surface(&job, worker->label_font, &worker->caches, NULL, &stats);
+
+        SDL_LockMutex(server->lock);
+        server->expr_hits += exprs->hits - expr_hits;
+        server->expr_misses += exprs->misses - expr_misses;
+        SDL_UnlockMutex(server->lock);
+    }
+    const bool hit = data != NULL;
 
-    TTF_SetFontSize(font, config->fontSize);
-    if (!TTF_GetStringSize(font, text.chars, text.length, &width, &height)) {
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to measure text: %s", SDL_GetError());
+    if (surface && stats.expression_error) {
+        // The renderer still drew the axes; a bad expression is never cached.
+        SDL_DestroySurface(surface);
+        serve_record(server, start, false, false, NULL);
+        return serve_reply_error(c, "expression does not parse");
+    }
+    if (surface) {
+        data = serve_encode(surface, png, &size);
+        width = surface->w;
+        height = surface->h;
+        SDL_DestroySurface(surface);
+        if (data) serve_store_image(server, key, data, size, width, height);
+    }
+    if (!data) {
+        serve_record(server, start, false, false, NULL);
+        return serve_reply_error(c, "render failed");
     }
 
-    return (Clay_Dimensions) { (float) width, (float) height };
+    bool sent = serve_reply(c, png ? "png" : "rgba", width, height, data, size);
+    free(data);
+    serve_record(server, start, true, hit, job.mode == GRAPH_MODE_FIELD ? &stats.field : NULL);
+    return sent;
 }
 
-void HandleClayErrors(Clay_ErrorData errorData) {
-    printf("%s", errorData.errorText.chars);
+static double serve_rate(Uint64 hits, Uint64 misses)
+{
+    return hits + misses ? (double)hits / (hits + misses) : 0.0;
 }
 
-Clay_RenderCommandArray ClayImageSample_CreateLayout(AppState *state) {
-    Clay_BeginLayout();
+static bool serve_handle_stats(PlotServer *server, ServeConnection *c)
+{
+    static const double percentiles[] = { 50, 90, 99 };
+    double *latencies = malloc(sizeof(double) * SERVE_LATENCY_RING);
+    if (!latencies) return serve_reply_error(c, "out of memory");
+
+    SDL_LockMutex(server->lock);
+    const Uint64 requests = server->requests, errors = server->errors;
+    const Uint64 image_hits = server->image_hits, image_misses = server->image_misses;
+    const Uint64 expr_hits = server->expr_hits, expr_misses = server->expr_misses;
+    const Uint64 tiles_visible = server->tiles_visible, tiles_evaluated = server->tiles_evaluated;
+    const size_t samples = (size_t)SDL_min(server->latency_count, (Uint64)SERVE_LATENCY_RING);
+    memcpy(latencies, server->latency_ms, sizeof(double) * samples);
+    int images = 0;
+    for (int i = 0; i < SERVE_IMAGE_CACHE; i++) images += server->images[i].last_used != 0;
+    const size_t image_bytes = server->image_bytes;
+    SDL_UnlockMutex(server->lock);
+
+    qsort(latencies, samples, sizeof(double), compare_doubles);
+
+    char text[1024];
+    int len = snprintf(text, sizeof(text), "requests %llu\nerrors %llu\nlatency_ms samples %zu",
+                       (unsigned long long)requests, (unsigned long long)errors, samples);
+    for (size_t i = 0; i < SDL_arraysize(percentiles); i++) {
+        len += snprintf(text + len, sizeof(text) - len, " p%.0f %.3f", percentiles[i],
+                        samples ? latencies[(size_t)((samples - 1) * percentiles[i] / 100)] : 0.0);
+    }
+    len += snprintf(text + len, sizeof(text) - len,
+                    " max %.3f\n"
+                    "image_cache hits %llu misses %llu hit_rate %.3f entries %d bytes %zu\n"
+                    "expr_cache hits %llu misses %llu hit_rate %.3f\n"
+                    "tile_cache visible %llu evaluated %llu hit_rate %.3f\n",
+                    samples ? latencies[samples - 1] : 0.0,
+                    (unsigned long long)image_hits, (unsigned long long)image_misses,
+                    serve_rate(image_hits, image_misses), images, image_bytes,
+                    (unsigned long long)expr_hits, (unsigned long long)expr_misses,
+                    serve_rate(expr_hits, expr_misses),
+                    (unsigned long long)tiles_visible, (unsigned long long)tiles_evaluated,
+                    serve_rate(tiles_visible - tiles_evaluated, tiles_evaluated));
+    free(latencies);
+
+    return serve_reply(c, "stats", 0, 0, text, (size_t)SDL_min(len, (int)sizeof(text) - 1));
+}
 
-    Clay_Sizing layoutExpand = {
-        .width = CLAY_SIZING_GROW(0),
-        .height = CLAY_SIZING_GROW(0)
-    };
+/* Unblocks the accept loop by connecting to our own socket. */
+static void serve_wake_listener(PlotServer *server)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    SDL_strlcpy(addr.sun_path, server->path, sizeof(addr.sun_path));
 
-    CLAY(CLAY_ID("OuterContainer"), {
-        .layout = {
-            .layoutDirection = CLAY_TOP_TO_BOTTOM,
-            .sizing = layoutExpand,
-            .padding = CLAY_PADDING_ALL(16),
-            .childGap = 16
+    ServeSocket s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == SERVE_INVALID_SOCKET) return;
+    connect(s, (struct sockaddr *)&addr, sizeof(addr));
+    serve_close_socket(s);
+}
+
+static void serve_connection(ServeWorker *worker, ServeSocket socket)
+{
+    PlotServer *server = worker->server;
+    ServeConnection *c = SDL_calloc(1, sizeof(ServeConnection));
+    if (!c) return;
+    c->socket = socket;
+    serve_set_timeout(socket, SERVE_IDLE_MS);
+
+    char line[512];
+    bool open = true;
+    ServeRead read = SERVE_READ_CLOSED;
+    while (open && (read = serve_read_line(c, line, sizeof(line))) == SERVE_READ_LINE) {
+        SDL_LockMutex(server->lock);
+        server->requests++;
+        SDL_UnlockMutex(server->lock);
+
+        if (strncmp(line, "render ", 7) == 0) {
+            open = serve_handle_render(worker, c, line + 7);
+        } else if (strcmp(line, "stats") == 0) {
+            open = serve_handle_stats(server, c);
+        } else if (strcmp(line, "shutdown") == 0) {
+            SDL_LockMutex(server->lock);
+            server->quit = true;
+            SDL_BroadcastCondition(server->pending);
+            SDL_UnlockMutex(server->lock);
+            serve_reply(c, "shutdown", 0, 0, NULL, 0);
+            serve_wake_listener(server);
+            open = false;
+        } else {
+            SDL_LockMutex(server->lock);
+            server->errors++;
+            SDL_UnlockMutex(server->lock);
+            open = serve_reply_error(c, "unknown request, expected render, stats or shutdown");
         }
-    }) {
-        CLAY(CLAY_ID("SampleImage"), {
-            .layout = {
-                .sizing = layoutExpand
-            },
-            .aspectRatio = { 23.0 / 42.0 },
-            .image = {
-                .imageData = sample_image,
-            }
-        });
     }
 
-    return Clay_EndLayout();
+    if (open && read == SERVE_READ_TOO_LONG) {
+        SDL_LockMutex(server->lock);
+        server->requests++;
+        server->errors++;
+        SDL_UnlockMutex(server->lock);
+        serve_reply_error(c, "request line too long");
+    } else if (open && read == SERVE_READ_IDLE) {
+        serve_reply_error(c, "idle timeout");
+    }
+
+    SDL_free(c);
 }
 
-Clay_RenderCommandArray ClayGraph_CreateLayout(AppState *state) {
-    Clay_BeginLayout();
+static int SDLCALL serve_worker_thread(void *data)
+{
+    ServeWorker *worker = data;
+    PlotServer *server = worker->server;
 
-    Clay_Sizing layoutExpand = {
-        .width = CLAY_SIZING_GROW(0),
-        .height = CLAY_SIZING_GROW(0)
-    };
+    SDL_LockMutex(server->lock);
+    for (;;) {
+        while (server->queue_count == 0 && !server->quit) {
+            SDL_WaitCondition(server->pending, server->lock);
+        }
+        if (server->quit) break;
 
-    CLAY(CLAY_ID("OuterContainer"), {
-        .layout = {
-            .layoutDirection = CLAY_TOP_TO_BOTTOM,
-            .sizing = layoutExpand,
-            .padding = CLAY_PADDING_ALL(16),
-            .childGap = 16
-        },
-        .backgroundColor = COLOR_LIGHT
-    }) {
-        static char title[512];
-        snprintf(title, sizeof(title), "Graph Plotter: %s", state->graphState.function);
-        Clay_String titleString = {
-            .chars = title, 
-            .length = strlen(title),
-            .isStaticallyAllocated = true
-        };
+        ServeSocket client = server->queue[server->queue_head];
+        server->queue_head = (server->queue_head + 1) % SERVE_QUEUE_SIZE;
+        server->queue_count--;
+        SDL_UnlockMutex(server->lock);
 
-        CLAY_TEXT(titleString, CLAY_TEXT_CONFIG({
-            .fontId = FONT_ID,
-            .fontSize = 32,
-            .textColor = {50, 50, 50, 255}
-        }));
+        serve_connection(worker, client);
+        serve_close_socket(client);
 
-        CLAY_TEXT(CLAY_STRING("WASD to pan • Z/X to zoom • Space to toggle • Hover for tangent"), CLAY_TEXT_CONFIG({
-            .fontId = FONT_ID,
-            .fontSize = 16,
-            .textColor = {100, 100, 100, 255}
-        }));
+        SDL_LockMutex(server->lock);
+    }
+    SDL_UnlockMutex(server->lock);
 
-        CLAY(CLAY_ID("GraphContainer"), {
-            .layout = {
-                .sizing = layoutExpand
-            },
-            .image = {
-                .imageData = state->graphState.graph_texture,
-            }
-        });
+    return 0;
+}
 
-        static char func_display[512];
-        snprintf(func_display, sizeof(func_display), "f(x) = %s", state->graphState.function);
-        Clay_String funcString = {
-            .chars = func_display,
-            .length = strlen(func_display),
-            .isStaticallyAllocated = true
-        };
+/* Runs the plot daemon on the calling thread until a client sends "shutdown".
+   Fonts, compiled expressions and field tiles stay warm across requests. */
+SDL_AppResult run_server(AppState *state, const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Socket path too long: %s", path);
+        return SDL_APP_FAILURE;
+    }
+    SDL_strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
 
-        CLAY_TEXT(funcString, CLAY_TEXT_CONFIG({
-            .fontId = FONT_ID,
-            .fontSize = 20,
-            .textColor = {50, 50, 50, 255}
-        }));
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "WSAStartup failed");
+        return SDL_APP_FAILURE;
+    }
+#else
+    // A socket left behind by a previous run that was killed; never touch other files.
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+#endif
+
+    ServeSocket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == SERVE_INVALID_SOCKET ||
+        bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listener, SERVE_QUEUE_SIZE) != 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to listen on %s", path);
+        if (listener != SERVE_INVALID_SOCKET) serve_close_socket(listener);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return SDL_APP_FAILURE;
     }
 
-    return Clay_EndLayout();
-}
+    PlotServer *server = SDL_calloc(1, sizeof(PlotServer));
+    const int worker_count = SDL_clamp(SDL_GetNumLogicalCPUCores(), 2, 8);
+    ServeWorker *workers = SDL_calloc(worker_count, sizeof(ServeWorker));
+    SDL_AppResult result = SDL_APP_SUCCESS;
 
-static const char *get_cmd_arg(int argc, char *argv[], const char *prefix)
-{
-    size_t len = strlen(prefix);
-    for (int i = 1; i < argc; i++) {
-        if (strncmp(argv[i], prefix, len) == 0) {
-            return argv[i] + len;
+    if (server) {
+        server->settings = &state->graphState;
+        server->lock = SDL_CreateMutex();
+        server->pending = SDL_CreateCondition();
+        SDL_strlcpy(server->path, path, sizeof(server->path));
+    }
+    if (!server || !workers || !server->lock || !server->pending) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to set up server: %s", SDL_GetError());
+        result = SDL_APP_FAILURE;
+    }
+
+    for (int i = 0; result == SDL_APP_SUCCESS && i < worker_count; i++) {
+        ServeWorker *w = &workers[i];
+        w->server = server;
+        // TTF fonts are not thread safe, so every worker draws labels with its own copy.
+        TTF_Font *font = state->graphState.renderer.label_font;
+        w->label_font = font ? TTF_CopyFont(font) : NULL;
+        if (!graph_caches_init(&w->caches, &state->graphState.renderer.pool)) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to set up server worker caches");
+            result = SDL_APP_FAILURE;
+            break;
+        }
+        w->thread = SDL_CreateThread(serve_worker_thread, "serve_worker", w);
+        if (!w->thread) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create server worker: %s", SDL_GetError());
+            result = SDL_APP_FAILURE;
         }
     }
-    return NULL;
+
+    if (result == SDL_APP_SUCCESS) {
+        SDL_Log("Serving plots on %s with %d workers", path, worker_count);
+    }
+
+    while (result == SDL_APP_SUCCESS) {
+        ServeSocket client = accept(listener, NULL, NULL);
+
+        SDL_LockMutex(server->lock);
+        const bool quit = server->quit;
+        const bool queued = !quit && client != SERVE_INVALID_SOCKET && server->queue_count < SERVE_QUEUE_SIZE;
+        if (queued) {
+            server->queue[(server->queue_head + server->queue_count) % SERVE_QUEUE_SIZE] = client;
+            server->queue_count++;
+            SDL_SignalCondition(server->pending);
+        }
+        SDL_UnlockMutex(server->lock);
+
+        if (quit) {
+            if (client != SERVE_INVALID_SOCKET) serve_close_socket(client);
+            break;
+        }
+        if (client == SERVE_INVALID_SOCKET) {
+            SDL_Delay(10);  // e.g. out of descriptors; don't spin
+        } else if (!queued) {
+            ServeConnection busy = { .socket = client };
+            serve_reply_error(&busy, "busy");
+            serve_close_socket(client);
+        }
+    }
+
+    if (server && server->lock) {
+        SDL_LockMutex(server->lock);
+        server->quit = true;
+        if (server->pending) SDL_BroadcastCondition(server->pending);
+        SDL_UnlockMutex(server->lock);
+    }
+    for (int i = 0; workers && i < worker_count; i++) {
+        if (workers[i].thread) SDL_WaitThread(workers[i].thread, NULL);
+        if (workers[i].label_font) TTF_CloseFont(workers[i].label_font);
+        graph_caches_destroy(&workers[i].caches);
+    }
+
+    serve_close_socket(listener);
+#ifdef _WIN32
+    WSACleanup();
+#else
+    unlink(path);
+#endif
+
+    if (server) {
+        while (server->queue_count > 0) {
+            serve_close_socket(server->queue[server->queue_head]);
+            server->queue_head = (server->queue_head + 1) % SERVE_QUEUE_SIZE;
+            server->queue_count--;
+        }
+        for (int i = 0; i < SERVE_IMAGE_CACHE; i++) free(server->images[i].data);
+        if (server->pending) SDL_DestroyCondition(server->pending);
+        if (server->lock) SDL_DestroyMutex(server->lock);
+        SDL_free(server);
+    }
+    SDL_free(workers);
+
+    return result;
 }
 
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
@@ -643,17 +3460,26 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
     }
     *appstate = state;
 
-    if (!SDL_CreateWindowAndRenderer("Clay + Graph Demo", 800, 600, 0, 
-                                     &state->window, &state->rendererData.renderer)) {
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create window and renderer: %s", SDL_GetError());
+    const char *replay_arg = get_cmd_arg(argc, argv, "--replay=");
+    if (replay_arg && !trace_open_replay(&state->trace, replay_arg, &state->graphState)) {
         return SDL_APP_FAILURE;
     }
-    SDL_SetWindowResizable(state->window, true);
 
-    state->rendererData.textEngine = TTF_CreateRendererTextEngine(state->rendererData.renderer);
-    if (!state->rendererData.textEngine) {
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create text engine: %s", SDL_GetError());
-        return SDL_APP_FAILURE;
+    const char *serve_arg = get_cmd_arg(argc, argv, "--serve=");
+
+    if (state->trace.mode != TRACE_REPLAY && !serve_arg) {
+        if (!SDL_CreateWindowAndRenderer("Clay + Graph Demo", 800, 600, 0, 
+                                         &state->window, &state->rendererData.renderer)) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create window and renderer: %s", SDL_GetError());
+            return SDL_APP_FAILURE;
+        }
+        SDL_SetWindowResizable(state->window, true);
+
+        state->rendererData.textEngine = TTF_CreateRendererTextEngine(state->rendererData.renderer);
+        if (!state->rendererData.textEngine) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create text engine: %s", SDL_GetError());
+            return SDL_APP_FAILURE;
+        }
     }
 
     state->rendererData.fonts = SDL_calloc(1, sizeof(TTF_Font *));
@@ -670,9 +3496,11 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 
     state->rendererData.fonts[FONT_ID] = font;
 
-    sample_image = IMG_LoadTexture(state->rendererData.renderer, "resources/sample.png");
-    if (!sample_image) {
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to load image: %s", SDL_GetError());
+    if (state->rendererData.renderer) {
+        sample_image = IMG_LoadTexture(state->rendererData.renderer, "resources/sample.png");
+        if (!sample_image) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to load image: %s", SDL_GetError());
+        }
     }
 
     uint64_t totalMemorySize = Clay_MinMemorySize();
@@ -682,13 +3510,14 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
     };
 
     int width, height;
-    SDL_GetWindowSize(state->window, &width, &height);
+    get_view_size(state, &width, &height);
     Clay_Initialize(clayMemory, (Clay_Dimensions) { (float) width, (float) height }, 
                    (Clay_ErrorHandler) { HandleClayErrors });
     Clay_SetMeasureTextFunction(SDL_MeasureText, state->rendererData.fonts);
 
     state->demoData = ClayVideoDemo_Initialize();
 
+    GraphState replayed = state->graphState;
     state->graphState = (GraphState) {
         .viewport = {
             .cx = 0.0,
@@ -697,14 +3526,24 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
             .yScale = 50.0
         },
         .velocity = {0, 0},
+        .integral_a = -1.0,
+        .integral_b = 1.0,
+        .dragging_bound = -1,
+        .precision_auto = true,
+        .dragging_param = -1,
         .needs_update = true,
         .mouseX = 0,
         .mouseY = 0,
         .mouse_in_window = false
     };
 
+    SDL_memcpy(state->graphState.params, GRAPH_PARAM_DEFAULT, sizeof(state->graphState.params));
+
     const char *func_arg = get_cmd_arg(argc, argv, "--func=");
-    if (func_arg && func_arg[0] != '\0') {
+    if (state->trace.mode == TRACE_REPLAY) {
+        SDL_strlcpy(state->graphState.function, replayed.function, sizeof(state->graphState.function));
+        SDL_memcpy(state->graphState.params, replayed.params, sizeof(state->graphState.params));
+    } else if (func_arg && func_arg[0] != '\0') {
         SDL_strlcpy(
             state->graphState.function,
             func_arg,
@@ -718,7 +3557,44 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
         );
     }
 
-    update_graph_texture(state, width - 32, height - 150);
+    const char *mode_arg = get_cmd_arg(argc, argv, "--mode=");
+    if (state->trace.mode == TRACE_REPLAY) {
+        state->graphState.mode = replayed.mode;
+    } else if (mode_arg && strcmp(mode_arg, "field") == 0) {
+        state->graphState.mode = GRAPH_MODE_FIELD;
+    }
+
+    // A replay runs the tier it was recorded with, or its frame times would not compare.
+    const char *precision_arg = get_cmd_arg(argc, argv, "--precision=");
+    if (state->trace.mode == TRACE_REPLAY) {
+        state->graphState.precision_auto = replayed.precision_auto;
+        state->graphState.precision = replayed.precision;
+    } else if (precision_arg && !parse_precision(precision_arg, &state->graphState.precision_auto,
+                                                 &state->graphState.precision)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Unknown --precision=%s, expected exact, high, fast or auto",
+                     precision_arg);
+        return SDL_APP_FAILURE;
+    }
+
+    if (!graph_renderer_start(&state->graphState.renderer, "external/resources/Roboto-Regular.ttf", 20)) {
+        return SDL_APP_FAILURE;
+    }
+
+    if (state->trace.mode == TRACE_REPLAY) {
+        const char *dt_arg = get_cmd_arg(argc, argv, "--replay-dt=");
+        return run_replay(state, dt_arg ? SDL_atof(dt_arg) : 0.0, get_cmd_arg(argc, argv, "--replay-async") != NULL);
+    }
+
+    if (serve_arg) {
+        return run_server(state, serve_arg);
+    }
+
+    const char *record_arg = get_cmd_arg(argc, argv, "--record=");
+    if (record_arg && !trace_open_record(&state->trace, record_arg, &state->graphState, width, height)) {
+        return SDL_APP_FAILURE;
+    }
+
+    request_graph_render(state, width - 32, height - 150);
 
     return SDL_APP_CONTINUE;
 }
@@ -727,53 +3603,8 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 {
     AppState *state = appstate;
 
-    switch (event->type) {
-        case SDL_EVENT_QUIT:
-            return SDL_APP_SUCCESS;
-            
-        case SDL_EVENT_KEY_UP:
-            if (event->key.scancode == SDL_SCANCODE_SPACE) {
-                show_demo = !show_demo;
-                if (!show_demo) show_graph = !show_graph;
-            }
-            break;
-            
-        case SDL_EVENT_WINDOW_RESIZED:
-            Clay_SetLayoutDimensions((Clay_Dimensions) { 
-                (float) event->window.data1, 
-                (float) event->window.data2 
-            });
-            state->graphState.needs_update = true;
-            break;
-            
-        case SDL_EVENT_MOUSE_MOTION:
-            Clay_SetPointerState((Clay_Vector2) { event->motion.x, event->motion.y },
-                                 event->motion.state & SDL_BUTTON_LMASK);
-            state->graphState.mouseX = event->motion.x;
-            state->graphState.mouseY = event->motion.y;
-            state->graphState.mouse_in_window = true;
-            break;
-            
-        case SDL_EVENT_MOUSE_BUTTON_DOWN:
-            Clay_SetPointerState((Clay_Vector2) { event->button.x, event->button.y },
-                                 event->button.button == SDL_BUTTON_LEFT);
-            state->graphState.mouseX = event->button.x;
-            state->graphState.mouseY = event->button.y;
-            break;
-            
-        case SDL_EVENT_WINDOW_MOUSE_LEAVE:
-            state->graphState.mouse_in_window = false;
-            break;
-            
-        case SDL_EVENT_MOUSE_WHEEL:
-            Clay_UpdateScrollContainers(true, (Clay_Vector2) { event->wheel.x, event->wheel.y }, 0.01f);
-            break;
-            
-        default:
-            break;
-    }
-
-    return SDL_APP_CONTINUE;
+    trace_record_event(&state->trace, event);
+    return handle_event(state, event);
 }
 
 SDL_AppResult SDL_AppIterate(void *appstate)
@@ -786,17 +3617,19 @@ SDL_AppResult SDL_AppIterate(void *appstate)
     if (dt > 0.1) dt = 0.1;
     last = now;
 
-    if (show_graph) {
-        update_graph_movement(&state->graphState, dt);
-        update_graph_zoom(&state->graphState, dt);
+    const bool *keys = SDL_GetKeyboardState(NULL);
+    trace_record_frame(&state->trace, now, dt, keys);
+    step_graph(state, keys, dt);
+    trace_record_view(&state->trace, &state->graphState);
 
-        if (state->graphState.needs_update) {
-            int width, height;
-            SDL_GetWindowSize(state->window, &width, &height);
-            update_graph_texture(state, width - 32, height - 150);
-        }
+    if (show_graph && state->graphState.needs_update) {
+        int width, height;
+        get_view_size(state, &width, &height);
+        request_graph_render(state, width - 32, height - 150);
     }
 
+    update_graph_texture(state);
+
     Clay_RenderCommandArray render_commands;
     if (show_demo) {
         render_commands = ClayVideoDemo_CreateLayout(&state->demoData);
@@ -811,12 +3644,13 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 
     SDL_Clay_RenderClayCommands(&state->rendererData, &render_commands);
 
-    if (show_graph && state->graphState.mouse_in_window) {
+    if (show_graph && state->graphState.mode == GRAPH_MODE_CURVE && state->graphState.mouse_in_window) {
         int width, height;
         SDL_GetWindowSize(state->window, &width, &height);
         draw_tangent(state->rendererData.renderer, 
                      &state->graphState.viewport,
                      state->graphState.function,
+                     state->graphState.params,
                      state->graphState.mouseX,
                      state->graphState.mouseY,
                      width, height);
@@ -839,7 +3673,12 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result)
         SDL_DestroyTexture(sample_image);
     }
 
+    SDL_Clay_ShutdownRenderer();
+
     if (state) {
+        graph_renderer_stop(&state->graphState.renderer);
+        trace_close(&state->trace);
+
         if (state->graphState.graph_texture) {
             SDL_DestroyTexture(state->graphState.graph_texture);
         }
@@ -0,0 +1,21 @@
+#include "tier_check.h"
+
+#include <math.h>
+
+/* Comparing against exact catches what a relative error bound on the result
+   cannot: cancellation, where the operands are far larger than the result
+   (cosh(x)-exp(x)/2 at x = 20). */
+te_precision tier_check(te_precision tier, te_expr *const trees[], double *x,
+                        const double *samples, int count, double tolerance)
+{
+    for (; tier != TE_PRECISION_EXACT; tier--) {
+        int i = 0;
+        for (; i < count; i++) {
+            *x = samples[i];
+            const double want = te_eval(trees[TE_PRECISION_EXACT]);
+            if (isfinite(want) && !(fabs(te_eval(trees[tier]) - want) <= tolerance)) break;
+        }
+        if (i == count) break;
+    }
+    return tier;
+}
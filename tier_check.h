@@ -0,0 +1,13 @@
+#ifndef TIER_CHECK_H
+#define TIER_CHECK_H
+
+#include "external/tinyexpr/tinyexpr.h"
+
+/* Fastest tier from tier down to TE_PRECISION_EXACT whose tree stays within
+   tolerance of the exact tree at every sample. trees is indexed by te_precision
+   up to tier, and every tree reads x through *x. A sample where the exact value
+   is not finite is skipped. */
+te_precision tier_check(te_precision tier, te_expr *const trees[], double *x,
+                        const double *samples, int count, double tolerance);
+
+#endif